@@ -0,0 +1,507 @@
+/**
+ * Benchmark-Suite fr den CircularBidirectionalFilereaderBuffer (Linux). Misst fr jede Kombination aus Elementgrsse,
+ * Cache-Lnge (DATA_TUPLES_CHACHE_LENGTH), Listener, Read-Engine und Zugriffsmuster:
+ * - Elemente pro Sekunde
+ * - Wartezeit des Lesers: wie oft und wie lange er auf den Fller warten musste (blockierendes getNext/getPrev)
+ * - Fill-Latenz: Perzentile der Dauer von fillUpwards/fillDownwards
+ *
+ * Engines: stdio, pread, io_uring, cached (BlockCacheReadEngine mit 16 + 5 Vierteln vor pread) und compressed
+ * (CompressedReadEngine vor pread auf einer komprimierten Kopie der Testdatei, Blcke zu COMPRESSED_BLOCK_LENGTH
+ * Elementen); die letzten beiden nicht im Standard.
+ * Zugriffsmuster: forward (Anfang bis Ende), backward (Ende bis Anfang), noisy (Zufallsweg, der mit der Wahrscheinlichkeit
+ * jitter/2 einen Schritt zurck macht; jitter 0 ist forward, 1 ein Zufallsweg ohne Richtung). Listener: default
+ * (DefaultListener, Fller-Thread) und sync (fllt im Leser-Thread). Die Testdateien enthalten aufsteigende Indizes und
+ * werden angelegt, wenn sie nicht die erwartete Grsse haben; jeder gelesene Wert wird geprft.
+ *
+ * Die Ausgabe geht als CSV (eine Kopfzeile) oder als JSON Lines nach stdout, Fortschritt nach stderr. So lassen sich die
+ * Ergebnisse verschiedener Releases vergleichen.
+ *
+ * Aufruf: Benchmark [--dir=.] [--mib=64] [--types=4,8,16,64] [--caches=4096,65536,1048576] [--listeners=default,sync]
+ *                   [--engines=stdio,pread,io_uring,cached,compressed] [--patterns=forward,backward,noisy] [--jitter=0.5]
+ *                   [--format=csv|json] [--warm]
+ * Ohne --warm wird die Datei vor jedem Durchlauf mit POSIX_FADV_DONTNEED aus dem Page-Cache geworfen (ohne Root-Rechte
+ * nicht garantiert; dann misst der Benchmark den Fall "Datei im Page-Cache").
+ */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+#include "BlockCacheReadEngine.hpp"
+#include "CompressedReadEngine.hpp"
+#include "PosixReadEngines.hpp"
+
+/** Element mit BYTES Bytes: Index in der Datei, Rest Nutzlast */
+template <size_t BYTES>
+struct Element_t {
+	uint64_t index;
+	char payload[BYTES - sizeof(uint64_t)];
+};
+
+template <>
+struct Element_t<8> {
+	uint64_t index;
+};
+
+/** Bei 4 Bytes luft der Index ab 2^32 Elementen ber, geprft wird dann modulo 2^32 */
+template <>
+struct Element_t<4> {
+	uint32_t index;
+};
+
+/** Cache-Lngen, fr die der Benchmark instanziert ist. DATA_TUPLES_CHACHE_LENGTH ist ein Template-Parameter. */
+static constexpr unsigned int CACHE_LENGTHS[]{ 1u << 12, 1u << 16, 1u << 20 };
+/** So lange wartet der Leser hchstens auf einen Fill, danach zhlt der Durchlauf als Fehler */
+static const std::chrono::seconds STALL_TIMEOUT{ 10 };
+/** Elemente pro Block der komprimierten Testdateien */
+static const size_t COMPRESSED_BLOCK_LENGTH{ 4096u };
+
+struct Config_t {
+	std::string dir{ "." };
+	size_t mib{ 64 };
+	std::vector<std::string> types{ "4", "8", "16", "64" };
+	std::vector<std::string> caches{ "4096", "65536", "1048576" };
+	std::vector<std::string> listeners{ "default", "sync" };
+	std::vector<std::string> engines{ "stdio", "pread", "io_uring" };
+	std::vector<std::string> patterns{ "forward", "backward", "noisy" };
+	double jitter{ 0.5 };
+	bool json{ false };
+	bool warm{ false };
+};
+
+struct Result_t {
+	bool ok{ true };
+	size_t elements{ 0 };
+	double seconds{ 0 };
+	size_t stalls{ 0 };
+	double stallSeconds{ 0 };
+	/** Dauer jedes Fills in ns */
+	std::vector<int64_t> fills;
+	/** Nur mit der Engine cached */
+	uint64_t blockCacheHits{ 0 };
+	uint64_t blockCacheMisses{ 0 };
+};
+
+/**
+ * Die feste Viertel-Regel des Buffers, zustzlich wird die Dauer jedes Fills festgehalten.
+ * onFill kommt nur vom Fller; ausgewertet wird erst nach dessen Ende.
+ */
+class RecordingPolicy : public IPrefetchPolicy {
+public:
+
+	RecordingPolicy(std::vector<int64_t> &fills) : fills_(fills) {}
+
+	virtual void onFill(bool, size_t, std::chrono::nanoseconds duration) override {
+		fills_.push_back(duration.count());
+	}
+
+private:
+
+	std::vector<int64_t> &fills_;
+};
+
+/** Fllt im Kontext des Lesers, ohne eigenen Thread */
+template <class TESTEE>
+class SyncListener : public TESTEE::IBackgroundTaskListener {
+public:
+
+	SyncListener(TESTEE &theBuffer) : theBuffer_(theBuffer) {
+		theBuffer_.setListener(this);
+	}
+
+	virtual void requestFill(bool up) override {
+		if (up) {
+			theBuffer_.fillUpwards();
+		} else {
+			theBuffer_.fillDownwards();
+		}
+	}
+
+	void tearDown() {}
+
+private:
+
+	TESTEE &theBuffer_;
+};
+
+static std::vector<std::string> split(const char *list) {
+	std::vector<std::string> items;
+	std::string item;
+	for (const char *p = list; ; p++) {
+		if (*p == ',' || *p == '\0') {
+			if (!item.empty()) {
+				items.push_back(item);
+			}
+			item.clear();
+			if (*p == '\0') {
+				break;
+			}
+		} else {
+			item += *p;
+		}
+	}
+	return items;
+}
+
+
+/** Legt die Datei mit aufsteigenden Indizes an, wenn sie nicht schon nElements Elemente hat. */
+template <class ELEMENT>
+static bool prepareFile(const std::string &path, size_t nElements) {
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == nElements * sizeof(ELEMENT)) {
+		return true;
+	}
+	fprintf(stderr, "Lege %s an ...\n", path.c_str());
+	FILE *f = fopen(path.c_str(), "wb");
+	if (f == nullptr) {
+		return false;
+	}
+	std::vector<ELEMENT> block((1u << 22) / sizeof(ELEMENT));
+	memset(block.data(), 0, block.size() * sizeof(ELEMENT));
+	bool ok = true;
+	for (size_t i = 0; i < nElements && ok; i += block.size()) {
+		const size_t n = std::min(block.size(), nElements - i);
+		for (size_t j = 0; j < n; j++) {
+			block[j].index = static_cast<decltype(block[j].index)>(i + j);
+		}
+		ok = fwrite(block.data(), sizeof(ELEMENT), n, f) == n;
+	}
+	return fclose(f) == 0 && ok;
+}
+
+/** Legt die komprimierte Kopie der Testdatei an, wenn es sie noch nicht gibt. */
+static bool prepareCompressedFile(const std::string &rawPath, const std::string &path, size_t elementSize) {
+	struct stat rawSt;
+	struct stat st;
+	if (stat(rawPath.c_str(), &rawSt) != 0) {
+		return false;
+	}
+	if (stat(path.c_str(), &st) == 0 && st.st_mtime >= rawSt.st_mtime) {
+		return true;
+	}
+	fprintf(stderr, "Lege %s an ...\n", path.c_str());
+	FILE *in = fopen(rawPath.c_str(), "rb");
+	FILE *out = fopen(path.c_str(), "wb");
+	bool ok = in != nullptr && out != nullptr;
+	if (ok) {
+		CompressedFormat::Writer writer{ out, elementSize, COMPRESSED_BLOCK_LENGTH };
+		std::vector<char> chunk(COMPRESSED_BLOCK_LENGTH * elementSize);
+		size_t n;
+		while (ok && (n = fread(chunk.data(), elementSize, COMPRESSED_BLOCK_LENGTH, in)) > 0) {
+			ok = writer.write(chunk.data(), n);
+		}
+		ok = writer.finish() && ok;
+		fprintf(stderr, "%lld Bytes -> %llu Bytes (%.1f %%)\n", static_cast<long long>(rawSt.st_size),
+			static_cast<unsigned long long>(writer.bytesWritten()), 100.0 * static_cast<double>(writer.bytesWritten()) / static_cast<double>(rawSt.st_size));
+	}
+	if (in != nullptr) {
+		fclose(in);
+	}
+	if (out != nullptr) {
+		ok = fclose(out) == 0 && ok;
+	}
+	return ok;
+}
+
+static void dropFromPageCache(const std::string &path) {
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+/**
+ * Ein Schritt mit getNext bzw. getPrev. Ist das Element noch nicht geladen, wartet der Leser blockierend darauf; das
+ * zhlt als Wartezeit.
+ */
+template <class TESTEE, class ELEMENT>
+static typename TESTEE::CacheState_t step(TESTEE &testee, bool up, ELEMENT &value, Result_t &result) {
+	typename TESTEE::CacheState_t state = up ? testee.getNext(value) : testee.getPrev(value);
+	if (state == TESTEE::CacheState_t::CACHE_OVERFLOW) {
+		const auto start = std::chrono::steady_clock::now();
+		state = up ? testee.getNext(value, STALL_TIMEOUT) : testee.getPrev(value, STALL_TIMEOUT);
+		const std::chrono::duration<double> stalled = std::chrono::steady_clock::now() - start;
+		result.stalls++;
+		result.stallSeconds += stalled.count();
+	}
+	return state;
+}
+
+template <class ELEMENT>
+static bool isAt(const ELEMENT &value, size_t position) {
+	return value.index == static_cast<decltype(value.index)>(position);
+}
+
+/** Luft das Zugriffsmuster pattern ab und prft jeden Wert. */
+template <class TESTEE, class ELEMENT>
+static void walk(TESTEE &testee, const std::string &pattern, double jitter, size_t nElements, Result_t &result) {
+	typedef typename TESTEE::CacheState_t CacheState_t;
+	ELEMENT value;
+	size_t position = 0;
+	if (pattern == "forward") {
+		CacheState_t state = CacheState_t::OK;
+		while (state != CacheState_t::END_OF_FILE && result.ok) {
+			state = step(testee, true, value, result);
+			result.ok = state != CacheState_t::CACHE_OVERFLOW && isAt(value, ++position);
+			result.elements++;
+		}
+	} else if (pattern == "backward") {
+		position = nElements - 1;
+		result.ok = testee.seek(position) == CacheState_t::OK;
+		CacheState_t state = CacheState_t::OK;
+		while (state != CacheState_t::END_OF_FILE && result.ok) {
+			state = step(testee, false, value, result);
+			result.ok = state != CacheState_t::CACHE_OVERFLOW && isAt(value, --position);
+			result.elements++;
+		}
+	} else {
+		std::mt19937_64 random{ 42 };
+		std::bernoulli_distribution back{ jitter / 2 };
+		for (size_t i = 0; i < nElements && result.ok; i++) {
+			bool up = !back(random);
+			if (position == 0) {
+				up = true;
+			} else if (position == nElements - 1) {
+				up = false;
+			}
+			const CacheState_t state = step(testee, up, value, result);
+			position = up ? position + 1 : position - 1;
+			result.ok = state != CacheState_t::CACHE_OVERFLOW && isAt(value, position);
+			result.elements++;
+		}
+	}
+}
+
+template <class TESTEE, class LISTENER, class ELEMENT>
+static Result_t measure(IReadEngine &engine, const std::string &pattern, double jitter, size_t nElements) {
+	Result_t result;
+	result.fills.reserve(1u << 16);
+	RecordingPolicy policy(result.fills);
+	const auto start = std::chrono::steady_clock::now();
+	auto *p_testee = new TESTEE(engine);
+	p_testee->setPrefetchPolicy(&policy);
+	auto *p_listener = new LISTENER(*p_testee);
+	walk<TESTEE, ELEMENT>(*p_testee, pattern, jitter, nElements, result);
+	p_listener->tearDown();
+	delete p_listener;
+	delete p_testee;
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	result.seconds = elapsed.count();
+	return result;
+}
+
+/** @return Perzentil p (0..1) der Fill-Dauern in s */
+static double percentile(std::vector<int64_t> &fills, double p) {
+	if (fills.empty()) {
+		return 0;
+	}
+	const size_t k = std::min(fills.size() - 1, static_cast<size_t>(p * static_cast<double>(fills.size())));
+	std::nth_element(fills.begin(), fills.begin() + static_cast<std::ptrdiff_t>(k), fills.end());
+	return static_cast<double>(fills[k]) / 1000.0;
+}
+
+static const char *CSV_HEADER =
+	"element_bytes,cache_length,listener,engine,pattern,jitter,file_mib,ok,elements,seconds,elements_per_s,"
+	"stalls,stall_seconds,fills,fill_p50_us,fill_p90_us,fill_p99_us,fill_max_us,block_cache_hits,block_cache_misses\n";
+
+static void report(const Config_t &config, size_t elementBytes, size_t cacheLength, const std::string &listener,
+	const std::string &engine, const std::string &pattern, Result_t &result) {
+	const double jitter = pattern == "noisy" ? config.jitter : 0.0;
+	const double rate = result.seconds > 0 ? static_cast<double>(result.elements) / result.seconds : 0.0;
+	const size_t nFills = result.fills.size();
+	const double p50 = percentile(result.fills, 0.50);
+	const double p90 = percentile(result.fills, 0.90);
+	const double p99 = percentile(result.fills, 0.99);
+	const double pMax = percentile(result.fills, 1.0);
+	if (config.json) {
+		printf("{\"element_bytes\":%zu,\"cache_length\":%zu,\"listener\":\"%s\",\"engine\":\"%s\",\"pattern\":\"%s\","
+			"\"jitter\":%.3f,\"file_mib\":%zu,\"ok\":%s,\"elements\":%zu,\"seconds\":%.6f,\"elements_per_s\":%.0f,"
+			"\"stalls\":%zu,\"stall_seconds\":%.6f,\"fills\":%zu,\"fill_p50_us\":%.1f,\"fill_p90_us\":%.1f,"
+			"\"fill_p99_us\":%.1f,\"fill_max_us\":%.1f,\"block_cache_hits\":%llu,\"block_cache_misses\":%llu}\n",
+			elementBytes, cacheLength, listener.c_str(), engine.c_str(), pattern.c_str(), jitter, config.mib,
+			result.ok ? "true" : "false", result.elements, result.seconds, rate, result.stalls, result.stallSeconds,
+			nFills, p50, p90, p99, pMax, static_cast<unsigned long long>(result.blockCacheHits),
+			static_cast<unsigned long long>(result.blockCacheMisses));
+	} else {
+		printf("%zu,%zu,%s,%s,%s,%.3f,%zu,%d,%zu,%.6f,%.0f,%zu,%.6f,%zu,%.1f,%.1f,%.1f,%.1f,%llu,%llu\n",
+			elementBytes, cacheLength, listener.c_str(), engine.c_str(), pattern.c_str(), jitter, config.mib,
+			result.ok ? 1 : 0, result.elements, result.seconds, rate, result.stalls, result.stallSeconds,
+			nFills, p50, p90, p99, pMax, static_cast<unsigned long long>(result.blockCacheHits),
+			static_cast<unsigned long long>(result.blockCacheMisses));
+	}
+	fflush(stdout);
+	fprintf(stderr, "%2zu B  %8zu  %-8s %-9s %-9s %s %12.0f Elemente/s\n", elementBytes, cacheLength, listener.c_str(),
+		engine.c_str(), pattern.c_str(), result.ok ? "ok    " : "FEHLER", rate);
+}
+
+/** Alle Listener, Engines und Zugriffsmuster fr eine Elementgrsse und eine Cache-Lnge */
+template <class ELEMENT, unsigned int CACHE_LENGTH>
+static bool runCache(const Config_t &config, const std::string &path, size_t nElements) {
+	typedef CircularBidirectionalFilereaderBuffer<ELEMENT, CACHE_LENGTH, true> Testee_t;
+	bool ok = true;
+	for (const std::string &engineName : config.engines) {
+		for (const std::string &listener : config.listeners) {
+			for (const std::string &pattern : config.patterns) {
+				const std::string enginePath = engineName == "compressed" ? path + ".cbfz" : path;
+				if (!config.warm) {
+					dropFromPageCache(enginePath);
+				}
+				FILE *f = fopen(enginePath.c_str(), "rb");
+				const int fd = open(enginePath.c_str(), O_RDONLY);
+				if (f == nullptr || fd < 0) {
+					return false;
+				}
+				std::unique_ptr<IReadEngine> disk;
+				std::unique_ptr<IReadEngine> engine;
+				std::string reportedEngine = engineName;
+				if (engineName == "stdio") {
+					engine.reset(new StdioReadEngine(f));
+				} else if (engineName == "pread") {
+					engine.reset(new PreadReadEngine(fd));
+				} else if (engineName == "cached") {
+					disk.reset(new PreadReadEngine(fd));
+					engine.reset(new BlockCacheReadEngine(*disk, CACHE_LENGTH / 4 * sizeof(ELEMENT), 16 + 5));
+				} else if (engineName == "compressed") {
+					disk.reset(new PreadReadEngine(fd));
+					engine.reset(new CompressedReadEngine(*disk));
+				} else {
+					auto *p_uringEngine = new IoUringReadEngine(fd, CACHE_LENGTH / 4 * sizeof(ELEMENT));
+					if (!p_uringEngine->isAvailable()) {
+						reportedEngine = "io_uring(pread)";
+					}
+					engine.reset(p_uringEngine);
+				}
+				Result_t result = listener == "sync"
+					? measure<Testee_t, SyncListener<Testee_t>, ELEMENT>(*engine, pattern, config.jitter, nElements)
+					: measure<Testee_t, typename Testee_t::DefaultListener, ELEMENT>(*engine, pattern, config.jitter, nElements);
+				if (engineName == "cached") {
+					const BlockCacheReadEngine::Stats_t blockCacheStats = static_cast<BlockCacheReadEngine &>(*engine).stats();
+					result.blockCacheHits = blockCacheStats.hits;
+					result.blockCacheMisses = blockCacheStats.misses;
+				}
+				report(config, sizeof(ELEMENT), CACHE_LENGTH, listener, reportedEngine, pattern, result);
+				ok = ok && result.ok;
+				engine.reset();
+				disk.reset();
+				close(fd);
+				fclose(f);
+			}
+		}
+	}
+	return ok;
+}
+
+template <class ELEMENT>
+static bool runType(const Config_t &config) {
+	const size_t nElements = config.mib * 1024u * 1024u / sizeof(ELEMENT);
+	const std::string path = config.dir + "/benchmark_" + std::to_string(sizeof(ELEMENT)) + "B_" + std::to_string(config.mib) + "MiB.bin";
+	if (nElements < 2 || !prepareFile<ELEMENT>(path, nElements)) {
+		fprintf(stderr, "%s kann nicht angelegt werden\n", path.c_str());
+		return false;
+	}
+	if (std::find(config.engines.begin(), config.engines.end(), "compressed") != config.engines.end()
+		&& !prepareCompressedFile(path, path + ".cbfz", sizeof(ELEMENT))) {
+		fprintf(stderr, "%s.cbfz kann nicht angelegt werden\n", path.c_str());
+		return false;
+	}
+	bool ok = true;
+	for (const std::string &cache : config.caches) {
+		const size_t cacheLength = static_cast<size_t>(strtoull(cache.c_str(), nullptr, 10));
+		if (cacheLength == CACHE_LENGTHS[0]) {
+			ok = runCache<ELEMENT, CACHE_LENGTHS[0]>(config, path, nElements) && ok;
+		} else if (cacheLength == CACHE_LENGTHS[1]) {
+			ok = runCache<ELEMENT, CACHE_LENGTHS[1]>(config, path, nElements) && ok;
+		} else if (cacheLength == CACHE_LENGTHS[2]) {
+			ok = runCache<ELEMENT, CACHE_LENGTHS[2]>(config, path, nElements) && ok;
+		} else {
+			fprintf(stderr, "Cache-Lnge %s nicht instanziert (%u, %u, %u)\n", cache.c_str(), CACHE_LENGTHS[0], CACHE_LENGTHS[1], CACHE_LENGTHS[2]);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	Config_t config;
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = strchr(arg, '=');
+		value = value != nullptr ? value + 1 : "";
+		if (strncmp(arg, "--dir=", 6) == 0) {
+			config.dir = value;
+		} else if (strncmp(arg, "--mib=", 6) == 0) {
+			config.mib = static_cast<size_t>(strtoull(value, nullptr, 10));
+		} else if (strncmp(arg, "--types=", 8) == 0) {
+			config.types = split(value);
+		} else if (strncmp(arg, "--caches=", 9) == 0) {
+			config.caches = split(value);
+		} else if (strncmp(arg, "--listeners=", 12) == 0) {
+			config.listeners = split(value);
+		} else if (strncmp(arg, "--engines=", 10) == 0) {
+			config.engines = split(value);
+		} else if (strncmp(arg, "--patterns=", 11) == 0) {
+			config.patterns = split(value);
+		} else if (strncmp(arg, "--jitter=", 9) == 0) {
+			config.jitter = std::min(1.0, std::max(0.0, atof(value)));
+		} else if (strcmp(arg, "--format=json") == 0) {
+			config.json = true;
+		} else if (strcmp(arg, "--format=csv") == 0) {
+			config.json = false;
+		} else if (strcmp(arg, "--warm") == 0) {
+			config.warm = true;
+		} else {
+			fprintf(stderr, "Unbekannte Option %s, @see Benchmark/Benchmark.cpp\n", arg);
+			return 2;
+		}
+	}
+	for (const std::string &listener : config.listeners) {
+		if (listener != "default" && listener != "sync") {
+			fprintf(stderr, "Unbekannter Listener %s\n", listener.c_str());
+			return 2;
+		}
+	}
+	for (const std::string &engine : config.engines) {
+		if (engine != "stdio" && engine != "pread" && engine != "io_uring" && engine != "cached" && engine != "compressed") {
+			fprintf(stderr, "Unbekannte Engine %s\n", engine.c_str());
+			return 2;
+		}
+	}
+	for (const std::string &pattern : config.patterns) {
+		if (pattern != "forward" && pattern != "backward" && pattern != "noisy") {
+			fprintf(stderr, "Unbekanntes Zugriffsmuster %s\n", pattern.c_str());
+			return 2;
+		}
+	}
+
+	if (!config.json) {
+		printf("%s", CSV_HEADER);
+	}
+	bool ok = true;
+	for (const std::string &type : config.types) {
+		if (type == "4") {
+			ok = runType<Element_t<4>>(config) && ok;
+		} else if (type == "8") {
+			ok = runType<Element_t<8>>(config) && ok;
+		} else if (type == "16") {
+			ok = runType<Element_t<16>>(config) && ok;
+		} else if (type == "64") {
+			ok = runType<Element_t<64>>(config) && ok;
+		} else {
+			fprintf(stderr, "Elementgrsse %s nicht untersttzt (4, 8, 16, 64)\n", type.c_str());
+			ok = false;
+		}
+	}
+	return ok ? 0 : 1;
+}
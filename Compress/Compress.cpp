@@ -0,0 +1,124 @@
+/**
+ * Wandelt eine Rohdatei (Array von Elementen fester Grsse) ins CompressedFormat um und zurck.
+ *
+ * Aufruf: Compress [--block=4096] <Elementgrsse> <roh.bin> <komprimiert.cbfz>
+ *         Compress -d <komprimiert.cbfz> <roh.bin>
+ *
+ * Beim Komprimieren wird die Ergebnisdatei anschliessend ber die CompressedReadEngine gelesen und mit der Rohdatei
+ * verglichen. Grssen, Kompressionsrate und Durchsatz gehen nach stderr.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "CompressedReadEngine.hpp"
+
+/** So viele Elemente werden auf einmal gelesen */
+static const size_t CHUNK_ELEMENTS{ 1u << 16 };
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int compress(size_t elementSize, size_t blockLength, const char *inPath, const char *outPath) {
+	FILE *in = fopen(inPath, "rb");
+	FILE *out = fopen(outPath, "wb");
+	if (in == nullptr || out == nullptr) {
+		fprintf(stderr, "%s bzw. %s kann nicht geffnet werden\n", inPath, outPath);
+		return 1;
+	}
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<char> chunk(CHUNK_ELEMENTS * elementSize);
+	CompressedFormat::Writer writer{ out, elementSize, blockLength };
+	bool ok = true;
+	size_t nElements = 0;
+	size_t n;
+	while (ok && (n = fread(chunk.data(), elementSize, CHUNK_ELEMENTS, in)) > 0) {
+		ok = writer.write(chunk.data(), n);
+		nElements += n;
+	}
+	ok = writer.finish() && ok;
+	const double seconds = secondsSince(start);
+	ok = fclose(out) == 0 && ok;
+	if (!ok) {
+		fprintf(stderr, "Fehler beim Schreiben von %s\n", outPath);
+		fclose(in);
+		return 1;
+	}
+	const double rawBytes = static_cast<double>(nElements) * static_cast<double>(elementSize);
+	fprintf(stderr, "%zu Elemente, %.0f Bytes -> %llu Bytes (%.1f %%), %.0f MiB/s\n", nElements, rawBytes,
+		static_cast<unsigned long long>(writer.bytesWritten()), 100.0 * static_cast<double>(writer.bytesWritten()) / std::max(rawBytes, 1.0),
+		rawBytes / 1048576.0 / seconds);
+
+	// Zurcklesen und vergleichen
+	FILE *check = fopen(outPath, "rb");
+	if (check == nullptr) {
+		fclose(in);
+		return 1;
+	}
+	StdioReadEngine disk{ check };
+	CompressedReadEngine engine{ disk };
+	ok = engine.isValid() && engine.size(elementSize) == nElements;
+	std::vector<char> decoded(chunk.size());
+	rewind(in);
+	const auto checkStart = std::chrono::steady_clock::now();
+	for (size_t first = 0; ok && first < nElements; first += CHUNK_ELEMENTS) {
+		n = fread(chunk.data(), elementSize, CHUNK_ELEMENTS, in);
+		ok = engine.read(decoded.data(), elementSize, n, first) == n && memcmp(chunk.data(), decoded.data(), n * elementSize) == 0;
+	}
+	fprintf(stderr, "Prfung %s, Dekodieren mit Vergleich %.0f MiB/s\n", ok ? "OK" : "FEHLGESCHLAGEN", rawBytes / 1048576.0 / secondsSince(checkStart));
+	fclose(check);
+	fclose(in);
+	return ok ? 0 : 1;
+}
+
+static int decompress(const char *inPath, const char *outPath) {
+	FILE *in = fopen(inPath, "rb");
+	FILE *out = fopen(outPath, "wb");
+	if (in == nullptr || out == nullptr) {
+		fprintf(stderr, "%s bzw. %s kann nicht geffnet werden\n", inPath, outPath);
+		return 1;
+	}
+	StdioReadEngine disk{ in };
+	CompressedReadEngine engine{ disk };
+	if (!engine.isValid()) {
+		fprintf(stderr, "%s ist nicht im CompressedFormat\n", inPath);
+		return 1;
+	}
+	const size_t elementSize = engine.elementSize();
+	const size_t nElements = engine.size(elementSize);
+	std::vector<char> chunk(CHUNK_ELEMENTS * elementSize);
+	bool ok = true;
+	for (size_t first = 0; ok && first < nElements; first += CHUNK_ELEMENTS) {
+		const size_t n = std::min(CHUNK_ELEMENTS, nElements - first);
+		ok = engine.read(chunk.data(), elementSize, n, first) == n && fwrite(chunk.data(), elementSize, n, out) == n;
+	}
+	ok = fclose(out) == 0 && ok;
+	fclose(in);
+	if (!ok) {
+		fprintf(stderr, "Fehler beim Dekomprimieren\n");
+	}
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+	size_t blockLength = 4096;
+	int i = 1;
+	if (i < argc && strncmp(argv[i], "--block=", 8) == 0) {
+		blockLength = static_cast<size_t>(strtoull(argv[i] + 8, nullptr, 10));
+		i++;
+	}
+	if (argc - i == 3 && strcmp(argv[i], "-d") == 0) {
+		return decompress(argv[i + 1], argv[i + 2]);
+	}
+	const size_t elementSize = argc - i == 3 ? static_cast<size_t>(strtoull(argv[i], nullptr, 10)) : 0;
+	if (elementSize == 0 || blockLength == 0) {
+		fprintf(stderr, "Aufruf: %s [--block=4096] <Elementgrsse> <roh.bin> <komprimiert.cbfz>\n"
+			"        %s -d <komprimiert.cbfz> <roh.bin>\n", argv[0], argv[0]);
+		return 2;
+	}
+	return compress(elementSize, blockLength, argv[i + 1], argv[i + 2]);
+}
@@ -0,0 +1,735 @@
+/**
+ * Stresstest fr den LOCK_FREE-Betrieb von CircularBidirectionalFilereaderBuffer (mit fread, IoUringReadEngine und
+ * BlockCacheReadEngine und CompressedReadEngine)
+ * und fr MappedBidirectionalFilereader und SharedFileCache (mehrere Cursor-Threads auf einem Cache).
+ * FollowTest liest im Folgemodus mit FileFollower eine Datei, an die ein Schreiber-Thread gleichzeitig anhngt, ber FILE*
+ * und ber IoUringReadEngine. Die Buffer laufen einzeln mit DefaultListener und zu mehreren mit einem FillScheduler.
+ * LargeFileTest liest um den Element-Index 2^32 einer (sparse) Datei ber 4 GiB, auch mit SegmentedReadEngine.
+ * StridedTest liest jedes k-te Element, PyramidTest liest eine Stufe der Min/Max-Pyramide, whrend sie gebaut wird.
+ * KeySeekTest springt mit seekToKey (mit und ohne KeyIndex), whrend der Fller luft.
+ * ber zwei DecodingReadEngine, die je die Bytes umkehren, dekodiert der Fller-Thread jeden Fill zweimal.
+ * FindReduceTest sucht mit findNext/findPrev und fasst mit reduceNext/reducePrev zusammen, whrend der Fller luft.
+ * Luft die Sequenz aus UnitTest1 (MyTest: vorwrts bis ans Dateiende, rckwrts bis an den Anfang) wiederholt gegen
+ * einen echten Fller-Thread (DefaultListener), zustzlich mit Spans, einem "noisy" Zufallsweg und Sprngen mit seek.
+ * Jeder zweite Durchlauf verwendet die AdaptivePrefetchPolicy. Mit BlockingTest auch die blockierenden getNext/getPrev.
+ * Gedacht fr einen Build mit ThreadSanitizer, @see CMakeLists.txt
+ *
+ * Aufruf: StressTest <testfile.bin> [Durchlufe]
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+#include "AdaptivePrefetchPolicy.hpp"
+#include "BlockCacheReadEngine.hpp"
+#include "CompressedReadEngine.hpp"
+#include "DecodingReadEngine.hpp"
+#include "FileFollower.hpp"
+#include "FillScheduler.hpp"
+#include "KeyIndex.hpp"
+#include "MappedBidirectionalFilereader.hpp"
+#include "MinMaxPyramid.hpp"
+#include "PosixReadEngines.hpp"
+#include "SegmentedReadEngine.hpp"
+#include "SharedFileCache.hpp"
+#include "StridedReadEngine.hpp"
+
+static const size_t CACHE_LEN{ 1024u };
+static const size_t N_ELEMENTS_IN_TESTFILE{ 8192u };
+/** testfile.bin muss Werte dieses Typs in aufsteigender Reihenfolge enthalten */
+typedef int TYPE_OF_DATA;
+typedef CircularBidirectionalFilereaderBuffer<TYPE_OF_DATA, CACHE_LEN, true> Testee_t;
+typedef DynamicFilereaderBuffer<TYPE_OF_DATA, true> DynamicTestee_t;
+typedef MappedBidirectionalFilereader<TYPE_OF_DATA, CACHE_LEN> MappedTestee_t;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) fehlgeschlagen\n", __FILE__, __LINE__, #cond); \
+			exit(1); \
+		} \
+	} while (0)
+
+/** Wiederholt getNext bzw. getPrev, solange der Fller nicht nachgekommen ist. Die Position bleibt dabei stehen. */
+template <class TESTEE, class VALUE>
+static typename TESTEE::CacheState_t step(TESTEE &testee, bool up, VALUE &value) {
+	typename TESTEE::CacheState_t state;
+	while ((state = up ? testee.getNext(value) : testee.getPrev(value)) == TESTEE::CacheState_t::CACHE_OVERFLOW) {
+		std::this_thread::yield();
+	}
+	return state;
+}
+
+template <class TESTEE>
+static void MyTest(TESTEE &testee) {
+	TYPE_OF_DATA value;
+	testee.getCurrent(value);
+	CHECK(value == 0);
+	TYPE_OF_DATA newValue;
+	typename TESTEE::CacheState_t state = TESTEE::CacheState_t::OK;
+	while (state != TESTEE::CacheState_t::END_OF_FILE) {
+		state = step(testee, true, newValue);
+		if (state == TESTEE::CacheState_t::END_OF_FILE && newValue == value) {
+			break;  // Dateiende erst beim Weiterlesen ber das letzte Element erkannt
+		}
+		CHECK(newValue == value + 1);
+		value = newValue;
+	}
+	CHECK(value == N_ELEMENTS_IN_TESTFILE - 1);
+	state = TESTEE::CacheState_t::OK;
+	while (state != TESTEE::CacheState_t::END_OF_FILE) {
+		state = step(testee, false, newValue);
+		CHECK(newValue == value - 1);
+		value = newValue;
+	}
+	CHECK(value == 0);
+}
+
+/** Wie MyTest, aber mit den blockierenden getNext und getPrev statt Wiederholen */
+template <class TESTEE>
+static void BlockingTest(TESTEE &testee) {
+	const std::chrono::seconds timeout{ 5 };
+	TYPE_OF_DATA value;
+	testee.getCurrent(value);
+	TYPE_OF_DATA newValue;
+	typename TESTEE::CacheState_t state = TESTEE::CacheState_t::OK;
+	while (state != TESTEE::CacheState_t::END_OF_FILE) {
+		state = testee.getNext(newValue, timeout);
+		CHECK(state != TESTEE::CacheState_t::CACHE_OVERFLOW);
+		if (state == TESTEE::CacheState_t::END_OF_FILE && newValue == value) {
+			break;
+		}
+		CHECK(newValue == value + 1);
+		value = newValue;
+	}
+	CHECK(value == N_ELEMENTS_IN_TESTFILE - 1);
+	state = TESTEE::CacheState_t::OK;
+	while (state != TESTEE::CacheState_t::END_OF_FILE) {
+		state = testee.getPrev(newValue, timeout);
+		CHECK(state != TESTEE::CacheState_t::CACHE_OVERFLOW);
+		if (state == TESTEE::CacheState_t::END_OF_FILE && newValue == value) {
+			break;
+		}
+		CHECK(newValue == value - 1);
+		value = newValue;
+	}
+	CHECK(value == 0);
+}
+
+/** Wie MyTest, aber in Blcken mit getNextSpan und getPrevSpan */
+static void SpanTest(Testee_t &testee) {
+	Testee_t::Span_t span;
+	TYPE_OF_DATA expected{ 1 };
+	Testee_t::CacheState_t state = Testee_t::CacheState_t::OK;
+	while (state != Testee_t::CacheState_t::END_OF_FILE) {
+		state = testee.getNextSpan(97, span);
+		for (size_t i = 0; i < span.firstLength; i++) {
+			CHECK(span.first[i] == expected++);
+		}
+		for (size_t i = 0; i < span.secondLength; i++) {
+			CHECK(span.second[i] == expected++);
+		}
+		if (span.size() == 0) {
+			std::this_thread::yield();
+		}
+	}
+	CHECK(expected == N_ELEMENTS_IN_TESTFILE);
+	expected = N_ELEMENTS_IN_TESTFILE - 2;
+	state = Testee_t::CacheState_t::OK;
+	while (state != Testee_t::CacheState_t::END_OF_FILE) {
+		state = testee.getPrevSpan(61, span);
+		for (size_t i = span.secondLength; i > 0; i--) {
+			CHECK(span.second[i - 1] == expected--);
+		}
+		for (size_t i = span.firstLength; i > 0; i--) {
+			CHECK(span.first[i - 1] == expected--);
+		}
+		if (span.size() == 0) {
+			std::this_thread::yield();
+		}
+	}
+	CHECK(expected == -1);
+}
+
+/** Zufallsweg mit leichtem Zug nach oben, damit beide Fill-Richtungen hufig und abwechselnd laufen. */
+template <class TESTEE>
+static void NoisyTest(TESTEE &testee, unsigned int seed) {
+	std::mt19937 random{ seed };
+	std::bernoulli_distribution up{ 0.6 };
+	TYPE_OF_DATA position{ 0 };
+	TYPE_OF_DATA value;
+	for (size_t i = 0; i < 4 * N_ELEMENTS_IN_TESTFILE; i++) {
+		bool goUp = up(random);
+		if (position == 0) {
+			goUp = true;
+		} else if (position == N_ELEMENTS_IN_TESTFILE - 1) {
+			goUp = false;
+		}
+		step(testee, goUp, value);
+		position += goUp ? 1 : -1;
+		CHECK(value == position);
+	}
+}
+
+/** Sprnge mit seek, teils innerhalb des Caches, teils weit weg, jeweils mit einem kurzen Weg danach */
+template <class TESTEE>
+static void SeekTest(TESTEE &testee, unsigned int seed) {
+	std::mt19937 random{ seed };
+	std::uniform_int_distribution<size_t> target{ 0, N_ELEMENTS_IN_TESTFILE - 1 };
+	std::uniform_int_distribution<int> walk{ -200, 200 };
+	TYPE_OF_DATA value;
+	for (int i = 0; i < 200; i++) {
+		TYPE_OF_DATA position = static_cast<TYPE_OF_DATA>(target(random));
+		CHECK(testee.seek(position) == TESTEE::CacheState_t::OK);
+		CHECK(testee.position() == static_cast<size_t>(position));
+		testee.getCurrent(value);
+		CHECK(value == position);
+		const int steps = walk(random);
+		for (int j = 0; j < std::abs(steps); j++) {
+			const bool goUp = steps > 0;
+			if ((goUp && position == N_ELEMENTS_IN_TESTFILE - 1) || (!goUp && position == 0)) {
+				break;
+			}
+			step(testee, goUp, value);
+			position += goUp ? 1 : -1;
+			CHECK(value == position);
+		}
+	}
+	CHECK(testee.seek(N_ELEMENTS_IN_TESTFILE) == TESTEE::CacheState_t::CACHE_OVERFLOW);
+	CHECK(testee.position() == N_ELEMENTS_IN_TESTFILE - 1);
+	CHECK(testee.seek(0) == TESTEE::CacheState_t::OK);
+}
+
+/**
+ * findNext/findPrev mit Schwellwerten und reduceNext/reducePrev ab zuflligen Positionen, whrend der Fller luft.
+ * Zuerst ohne Warten; meldet das CACHE_OVERFLOW, sucht der Aufruf mit timeout an der Stelle weiter.
+ */
+static void FindReduceTest(Testee_t &testee, unsigned int seed) {
+	using namespace std::chrono_literals;
+	typedef Testee_t::CacheState_t State_t;
+	const TYPE_OF_DATA last = static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1);
+	std::mt19937 random{ seed };
+	std::uniform_int_distribution<TYPE_OF_DATA> target{ 0, last };
+	std::uniform_int_distribution<TYPE_OF_DATA> threshold{ -10, last + 10 };
+	std::uniform_int_distribution<size_t> count{ 1, 3 * CACHE_LEN };
+	TYPE_OF_DATA value;
+	for (int i = 0; i < 100; i++) {
+		const TYPE_OF_DATA start = target(random);
+		CHECK(testee.seek(start) == State_t::OK);
+		const TYPE_OF_DATA above = threshold(random);
+		State_t state = testee.findNext(SpanKernels::Above<TYPE_OF_DATA>{ above }, value);
+		if (state == State_t::CACHE_OVERFLOW) {
+			state = testee.findNext(SpanKernels::Above<TYPE_OF_DATA>{ above }, value, 10s);
+		}
+		const TYPE_OF_DATA found = std::max(start, above) + 1;
+		CHECK(state == (found <= last ? State_t::OK : State_t::END_OF_FILE));
+		CHECK(value == std::min(found, last));
+		CHECK(testee.position() == static_cast<size_t>(value));
+
+		CHECK(testee.seek(start) == State_t::OK);
+		const TYPE_OF_DATA below = threshold(random);
+		state = testee.findPrev(SpanKernels::Below<TYPE_OF_DATA>{ below }, value);
+		if (state == State_t::CACHE_OVERFLOW) {
+			state = testee.findPrev(SpanKernels::Below<TYPE_OF_DATA>{ below }, value, 10s);
+		}
+		const TYPE_OF_DATA foundBelow = std::min(start, below) - 1;
+		CHECK(state == (foundBelow >= 0 ? State_t::OK : State_t::END_OF_FILE));
+		CHECK(value == std::max(foundBelow, 0));
+		CHECK(testee.position() == static_cast<size_t>(value));
+
+		CHECK(testee.seek(start) == State_t::OK);
+		const size_t n = count(random);
+		const bool up = i % 2 == 0;
+		SpanSummary_t<TYPE_OF_DATA> summary;
+		state = up ? testee.reduceNext(n, summary, 10s) : testee.reducePrev(n, summary, 10s);
+		const TYPE_OF_DATA end = up ? std::min<TYPE_OF_DATA>(start + static_cast<TYPE_OF_DATA>(n), last) : std::max<TYPE_OF_DATA>(start - static_cast<TYPE_OF_DATA>(n), 0);
+		CHECK(state == ((up ? end == last : end == 0) ? State_t::END_OF_FILE : State_t::OK));
+		CHECK(testee.position() == static_cast<size_t>(end));
+		const TYPE_OF_DATA low = up ? start + 1 : end;
+		const TYPE_OF_DATA high = up ? end : start - 1;
+		CHECK(summary.count == static_cast<size_t>(high - low + 1));
+		if (summary.count > 0) {
+			CHECK(summary.min == low && summary.max == high);
+			CHECK(summary.sum == (static_cast<int64_t>(low) + high) * (high - low + 1) / 2);
+		}
+	}
+	CHECK(testee.seek(0) == State_t::OK);
+}
+
+/**
+ * Ein Schreiber-Thread hngt in zuflligen Stcken an eine neue Datei an, jedes Stck in zwei write-Aufrufen, die meist
+ * mitten in einem Element getrennt sind. Der Leser folgt mit dem blockierenden getNext und muss jedes Element genau
+ * einmal sehen, danach rckwrts bis an den Anfang.
+ * @param ioUring ber IoUringReadEngine statt FILE*, mit kleinem Cache und kleinen Stcken: Der Leser wartet meist am
+ *        Dateiende, Fills und Vorladen laufen immer wieder ber das Dateiende hinaus.
+ */
+static void FollowTest(unsigned int seed, bool ioUring) {
+	char path[] = "/tmp/followtestXXXXXX";
+	const int writeFd = mkstemp(path);
+	CHECK(writeFd >= 0);
+	const size_t capacity = ioUring ? 64 : CACHE_LEN;
+	// Mit io_uring schon mehr, als initialize liest: dann ldt schon der erste Fill ber das Dateiende hinaus vor
+	std::vector<TYPE_OF_DATA> initial(ioUring ? capacity / 4 * 3 : 1);
+	for (size_t i = 0; i < initial.size(); i++) {
+		initial[i] = static_cast<TYPE_OF_DATA>(i);
+	}
+	const ssize_t initialLength = static_cast<ssize_t>(initial.size() * sizeof(TYPE_OF_DATA));
+	CHECK(write(writeFd, initial.data(), initialLength) == initialLength);
+	FILE *file = ioUring ? nullptr : fopen(path, "rb");
+	const int readFd = ioUring ? open(path, O_RDONLY) : -1;
+	CHECK(ioUring ? readFd >= 0 : file != nullptr);
+	auto *p_engine = ioUring ? new IoUringReadEngine(readFd, capacity / 4 * sizeof(TYPE_OF_DATA)) : nullptr;
+	auto *p_testee = ioUring ? new DynamicTestee_t(*p_engine, capacity) : new DynamicTestee_t(file, capacity);
+	auto *p_listener = new DynamicTestee_t::DefaultListener(*p_testee);
+	p_testee->setFollow(true);
+	auto *p_follower = new FileFollower<DynamicTestee_t>(*p_testee, path, std::chrono::milliseconds(20));
+	std::thread writer([writeFd, seed, ioUring, &initial] {
+		std::mt19937 random{ seed };
+		std::uniform_int_distribution<int> chunk{ 1, ioUring ? 13 : 300 };
+		std::uniform_int_distribution<int> pause{ 0, 500 };
+		std::vector<TYPE_OF_DATA> values;
+		TYPE_OF_DATA next{ static_cast<TYPE_OF_DATA>(initial.size()) };
+		while (next < static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE)) {
+			values.clear();
+			for (int n = chunk(random); n > 0 && next < static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE); n--) {
+				values.push_back(next++);
+			}
+			const char *bytes = reinterpret_cast<const char *>(values.data());
+			const ssize_t length = static_cast<ssize_t>(values.size() * sizeof(TYPE_OF_DATA));
+			const ssize_t split = length / 2 + 1;
+			CHECK(write(writeFd, bytes, split) == split);
+			std::this_thread::sleep_for(std::chrono::microseconds(pause(random)));
+			CHECK(write(writeFd, bytes + split, length - split) == length - split);
+			std::this_thread::sleep_for(std::chrono::microseconds(pause(random)));
+		}
+	});
+	TYPE_OF_DATA value;
+	p_testee->getCurrent(value);
+	CHECK(value == 0);
+	TYPE_OF_DATA expected{ 0 };
+	while (expected < static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1)) {
+		// Nach 5 s ohne neues Element (END_OF_FILE mit dem alten Wert) ist etwas hngen geblieben
+		CHECK(p_testee->getNext(value, std::chrono::seconds(5)) != DynamicTestee_t::CacheState_t::CACHE_OVERFLOW);
+		CHECK(value == expected + 1);
+		expected = value;
+	}
+	writer.join();
+	DynamicTestee_t::CacheState_t state = DynamicTestee_t::CacheState_t::OK;
+	while (state != DynamicTestee_t::CacheState_t::END_OF_FILE) {
+		state = step(*p_testee, false, value);
+		CHECK(value == --expected);
+	}
+	CHECK(expected == 0);
+	p_follower->tearDown();
+	delete p_follower;
+	p_listener->tearDown();
+	delete p_listener;
+	delete p_testee;
+	if (ioUring) {
+		delete p_engine;
+		close(readFd);
+	} else {
+		fclose(file);
+	}
+	close(writeFd);
+	unlink(path);
+}
+
+typedef CircularBidirectionalFilereaderBuffer<uint8_t, CACHE_LEN, true> ByteTestee_t;
+/** LargeFileTest: beschrieben sind nur die Elemente LARGE_MIDDLE +- LARGE_WINDOW, davor ist die Datei ein Loch */
+static const uint64_t LARGE_MIDDLE{ 1ull << 32 };
+static const uint64_t LARGE_WINDOW{ 1u << 16 };
+
+/** Inhalt des Elements i. Nie 0, damit ein Lesen aus dem Loch auffllt. */
+static uint8_t largePattern(uint64_t i) {
+	return static_cast<uint8_t>((i ^ (i >> 8) ^ (i >> 32)) | 1);
+}
+
+/** Schreibt die Elemente first bis last - 1 */
+static void writeLargePattern(int fd, uint64_t fileOffset, uint64_t first, uint64_t last) {
+	std::vector<uint8_t> bytes;
+	for (uint64_t i = first; i < last; i++) {
+		bytes.push_back(largePattern(i));
+	}
+	CHECK(pwrite(fd, bytes.data(), bytes.size(), static_cast<off_t>(fileOffset)) == static_cast<ssize_t>(bytes.size()));
+}
+
+/** seek hinter 2^32, vorwrts bis ans Ende (Element end - 1), rckwrts bis LARGE_MIDDLE - LARGE_WINDOW */
+static void LargeWalk(ByteTestee_t &testee, uint64_t end) {
+	uint64_t position = LARGE_MIDDLE - LARGE_WINDOW / 2;
+	CHECK(testee.seek(position) == ByteTestee_t::CacheState_t::OK);
+	CHECK(testee.position() == position);
+	uint8_t value;
+	testee.getCurrent(value);
+	CHECK(value == largePattern(position));
+	ByteTestee_t::CacheState_t state = ByteTestee_t::CacheState_t::OK;
+	while (state != ByteTestee_t::CacheState_t::END_OF_FILE) {
+		CHECK(position < end - 1);
+		state = step(testee, true, value);
+		CHECK(value == largePattern(++position));
+	}
+	CHECK(position == end - 1);
+	CHECK(testee.position() == position);
+	while (position > LARGE_MIDDLE - LARGE_WINDOW) {
+		step(testee, false, value);
+		CHECK(value == largePattern(--position));
+	}
+	CHECK(testee.position() == position);
+	CHECK(testee.seek(end + 100) == ByteTestee_t::CacheState_t::CACHE_OVERFLOW);
+	CHECK(testee.position() == end - 1);
+}
+
+/**
+ * ber 4 GiB (mehr als 2^32 Elemente) mit fread, pread und als zwei Segmente, deren Grenze auch hinter 2^32 liegt.
+ * Die grosse Datei ist sparse, belegt wird nur der beschriebene Bereich.
+ */
+static void LargeFileTest() {
+	char path[] = "/tmp/largetestXXXXXX";
+	char nextPath[] = "/tmp/largetestnextXXXXXX";
+	const int fd = mkstemp(path);
+	const int nextFd = mkstemp(nextPath);
+	CHECK(fd >= 0 && nextFd >= 0);
+	const uint64_t end = LARGE_MIDDLE + LARGE_WINDOW;
+	writeLargePattern(fd, LARGE_MIDDLE - LARGE_WINDOW, LARGE_MIDDLE - LARGE_WINDOW, end);
+	writeLargePattern(nextFd, 0, end, end + LARGE_WINDOW);
+
+	FILE *file = fopen(path, "rb");
+	CHECK(file != nullptr);
+	PreadReadEngine disk(fd);
+	SegmentedReadEngine segments({ path, nextPath });
+	CHECK(segments.size(1) == end + LARGE_WINDOW);
+	for (int engine = 0; engine < 3; engine++) {
+		auto *p_testee = engine == 0 ? new ByteTestee_t(file) : new ByteTestee_t(engine == 1 ? static_cast<IReadEngine &>(disk) : segments);
+		auto *p_listener = new ByteTestee_t::DefaultListener(*p_testee);
+		LargeWalk(*p_testee, engine == 2 ? end + LARGE_WINDOW : end);
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	fclose(file);
+	close(fd);
+	close(nextFd);
+	unlink(path);
+	unlink(nextPath);
+}
+
+/**
+ * Sprnge mit seekToKey auf zufllige Schlssel (Wert / 3, also je drei gleiche), jeder zweite ber einen KeyIndex,
+ * jeweils mit einem kurzen Weg danach
+ */
+static void KeySeekTest(Testee_t &testee, IReadEngine &indexDisk, unsigned int seed) {
+	auto byThree = [](const TYPE_OF_DATA &value) { return value / 3; };
+	KeyIndex<TYPE_OF_DATA, TYPE_OF_DATA, decltype(byThree)> index(indexDisk, byThree, CACHE_LEN / 4);
+	std::mt19937 random{ seed };
+	std::uniform_int_distribution<TYPE_OF_DATA> target{ -10, static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE / 3 + 10) };
+	std::uniform_int_distribution<int> walk{ -100, 100 };
+	TYPE_OF_DATA value;
+	for (int i = 0; i < 200; i++) {
+		const TYPE_OF_DATA key = target(random);
+		const Testee_t::CacheState_t state = i % 2 == 0 ? testee.seekToKey(key, byThree) : index.seek(testee, key);
+		TYPE_OF_DATA position = std::min(std::max(3 * key, 0), static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1));
+		CHECK(state == (3 * key >= static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE) ? Testee_t::CacheState_t::CACHE_OVERFLOW : Testee_t::CacheState_t::OK));
+		CHECK(testee.position() == static_cast<size_t>(position));
+		testee.getCurrent(value);
+		CHECK(value == position);
+		const int steps = walk(random);
+		for (int j = 0; j < std::abs(steps); j++) {
+			const bool goUp = steps > 0;
+			if ((goUp && position == N_ELEMENTS_IN_TESTFILE - 1) || (!goUp && position == 0)) {
+				break;
+			}
+			step(testee, goUp, value);
+			position += goUp ? 1 : -1;
+			CHECK(value == position);
+		}
+	}
+	CHECK(testee.seek(0) == Testee_t::CacheState_t::OK);
+}
+
+/** Jedes stride-te Element ab offset, vorwrts bis ans Ende und zurck */
+static void StridedTest(IReadEngine &disk, size_t stride, size_t offset, size_t denseBytes) {
+	StridedReadEngine engine(disk, stride, offset, denseBytes);
+	const size_t n = (N_ELEMENTS_IN_TESTFILE - offset - 1) / stride + 1;
+	CHECK(engine.size(sizeof(TYPE_OF_DATA)) == n);
+	auto *p_testee = new Testee_t(engine);
+	auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+	TYPE_OF_DATA value;
+	p_testee->getCurrent(value);
+	CHECK(value == static_cast<TYPE_OF_DATA>(offset));
+	size_t i = 0;
+	Testee_t::CacheState_t state = Testee_t::CacheState_t::OK;
+	while (state != Testee_t::CacheState_t::END_OF_FILE) {
+		state = step(*p_testee, true, value);
+		CHECK(value == static_cast<TYPE_OF_DATA>(offset + ++i * stride));
+	}
+	CHECK(i == n - 1);
+	while (i > 0) {
+		step(*p_testee, false, value);
+		CHECK(value == static_cast<TYPE_OF_DATA>(offset + --i * stride));
+	}
+	p_listener->tearDown();
+	delete p_listener;
+	delete p_testee;
+}
+
+/**
+ * Ein PyramidBuilder baut in kleinen Stcken, ein Leser folgt Stufe 1 im Folgemodus, whrend sie wchst, und liest
+ * danach rckwrts bis an den Anfang.
+ */
+static void PyramidTest(const char *testfile) {
+	typedef CircularBidirectionalFilereaderBuffer<PyramidEntry_t<TYPE_OF_DATA>, CACHE_LEN / 4, true> LevelTestee_t;
+	const size_t factor = 4;
+	char path[] = "/tmp/pyramidtestXXXXXX";
+	const int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	FILE *file = fopen(testfile, "rb");
+	CHECK(file != nullptr);
+	StdioReadEngine source(file);
+	PyramidBuilder<TYPE_OF_DATA> builder(source, path, factor, 100);
+	CHECK(builder.isValid());
+	while (builder.builtElements() < factor) {
+		std::this_thread::yield();
+	}
+	PreadReadEngine sidecar(fd);
+	PyramidReadEngine level(sidecar, 1);
+	CHECK(level.isValid());
+	auto *p_testee = new LevelTestee_t(level);
+	auto *p_listener = new LevelTestee_t::DefaultListener(*p_testee);
+	p_testee->setFollow(true);
+	auto check = [](const PyramidEntry_t<TYPE_OF_DATA> &entry, size_t i) {
+		CHECK(entry.min == static_cast<TYPE_OF_DATA>(factor * i));
+		CHECK(entry.max == static_cast<TYPE_OF_DATA>(factor * i + factor - 1));
+		CHECK(entry.mean == factor * i + (factor - 1) / 2.0);
+	};
+	PyramidEntry_t<TYPE_OF_DATA> entry;
+	p_testee->getCurrent(entry);
+	check(entry, 0);
+	const size_t n = N_ELEMENTS_IN_TESTFILE / factor;
+	size_t i = 0;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (i < n - 1) {
+		CHECK(std::chrono::steady_clock::now() < deadline);
+		p_testee->getNext(entry, std::chrono::milliseconds(5));
+		if (p_testee->position() == i) {
+			p_testee->notifyFileGrown();  // Stand des Builders nachlesen lassen
+			continue;
+		}
+		check(entry, ++i);
+	}
+	CHECK(builder.waitForCompletion(std::chrono::seconds(10)));
+	while (i > 0) {
+		step(*p_testee, false, entry);
+		check(entry, --i);
+	}
+	builder.tearDown();
+	p_listener->tearDown();
+	delete p_listener;
+	delete p_testee;
+	fclose(file);
+	close(fd);
+	unlink(path);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Aufruf: %s <testfile.bin> [Durchlufe]\n", argv[0]);
+		return 2;
+	}
+	const int nRuns = argc > 2 ? atoi(argv[2]) : 100;
+	FILE *f = fopen(argv[1], "rb");
+	CHECK(f != nullptr);
+	for (int run = 0; run < nRuns; run++) {
+		AdaptivePrefetchPolicy policy;
+		auto *p_testee = new Testee_t(f);
+		if (run % 2 == 1) {
+			p_testee->setPrefetchPolicy(&policy);
+		}
+		auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		SpanTest(*p_testee);
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		SeekTest(*p_testee, static_cast<unsigned int>(run));
+		BlockingTest(*p_testee);
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	// Lnge zur Laufzeit: einmal wie oben, einmal mit einem Cache grsser als die Datei (Huge Pages, sofern vorhanden)
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new DynamicTestee_t(f, run % 10 == 0 ? (1u << 20) : CACHE_LEN);
+		CHECK(p_testee->stats().allocatedBytes >= p_testee->capacity() * sizeof(TYPE_OF_DATA));
+		auto *p_listener = new DynamicTestee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		SeekTest(*p_testee, static_cast<unsigned int>(run));
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	// Komprimierte Kopie, dekodiert im Fller-Thread. Blcke absichtlich nicht auf den Viertelsgrenzen.
+	FILE *compressed = tmpfile();
+	CHECK(compressed != nullptr);
+	{
+		CompressedFormat::Writer writer(compressed, sizeof(TYPE_OF_DATA), CACHE_LEN / 4 + 7);
+		std::vector<TYPE_OF_DATA> raw(N_ELEMENTS_IN_TESTFILE);
+		CHECK(fseek(f, 0, SEEK_SET) == 0 && fread(raw.data(), sizeof(TYPE_OF_DATA), raw.size(), f) == raw.size());
+		CHECK(writer.write(raw.data(), raw.size()) && writer.finish());
+	}
+	StdioReadEngine compressedDisk(compressed);
+	CompressedReadEngine compressedEngine(compressedDisk);
+	CHECK(compressedEngine.isValid());
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new Testee_t(compressedEngine);
+		auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		SeekTest(*p_testee, static_cast<unsigned int>(run));
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	fclose(compressed);
+	fclose(f);
+
+	// Mehrere Buffer mit je einem Leser-Thread teilen sich zwei Fller
+	FillScheduler scheduler{2};
+	for (int run = 0; run < nRuns / 10 + 1; run++) {
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; i++) {
+			readers.emplace_back([&scheduler, run, i, &argv] {
+				FILE *file = fopen(argv[1], "rb");
+				CHECK(file != nullptr);
+				auto *p_testee = new Testee_t(file);
+				auto *p_listener = new FillScheduler::Listener<Testee_t>(scheduler, *p_testee);
+				MyTest(*p_testee);
+				NoisyTest(*p_testee, static_cast<unsigned int>(4 * run + i));
+				BlockingTest(*p_testee);
+				p_listener->tearDown();
+				delete p_listener;
+				delete p_testee;
+				fclose(file);
+			});
+		}
+		for (std::thread &reader : readers) {
+			reader.join();
+		}
+	}
+	scheduler.tearDown();
+
+	for (int run = 0; run < nRuns / 10 + 1; run++) {
+		FollowTest(static_cast<unsigned int>(run), false);
+		FollowTest(static_cast<unsigned int>(run), true);
+	}
+	LargeFileTest();
+	for (int run = 0; run < nRuns / 10 + 1; run++) {
+		PyramidTest(argv[1]);
+	}
+
+	const int fd = open(argv[1], O_RDONLY);
+	CHECK(fd >= 0);
+	// Fills ber pread bzw. io_uring statt fread
+	IoUringReadEngine engine(fd, CACHE_LEN / 4 * sizeof(TYPE_OF_DATA));
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new Testee_t(engine);
+		auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		SpanTest(*p_testee);
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		SeekTest(*p_testee, static_cast<unsigned int>(run));
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	// Block-Cache vor pread, klein genug, dass auch verdrngt wird
+	PreadReadEngine disk(fd);
+	BlockCacheReadEngine cachedEngine(disk, CACHE_LEN / 4 * sizeof(TYPE_OF_DATA), 7);
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new Testee_t(cachedEngine);
+		auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		SeekTest(*p_testee, static_cast<unsigned int>(run));
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	CHECK(cachedEngine.stats().hits > 0);
+	for (int run = 0; run < nRuns / 10 + 1; run++) {
+		StridedTest(disk, 3, 1, 4096);
+		StridedTest(disk, 7, static_cast<size_t>(run), 0);
+	}
+	// seekToKey ber pread, der KeyIndex mit eigener Engine auf demselben Deskriptor
+	PreadReadEngine indexDisk(fd);
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new Testee_t(engine);
+		auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+		KeySeekTest(*p_testee, indexDisk, static_cast<unsigned int>(run));
+		FindReduceTest(*p_testee, static_cast<unsigned int>(run));
+		MyTest(*p_testee);
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	// Zweimal die Bytes umgekehrt ergibt wieder die Werte der Datei
+	typedef DecodingReadEngine<TYPE_OF_DATA, TYPE_OF_DATA, ByteSwapTransform<TYPE_OF_DATA>> Swapping_t;
+	Swapping_t swapped(engine);
+	Swapping_t swappedBack(static_cast<IReadEngine &>(swapped));  // sonst der Kopierkonstruktor
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new Testee_t(swappedBack);
+		auto *p_listener = new Testee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		SeekTest(*p_testee, static_cast<unsigned int>(run));
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	// Vier Cursor-Threads auf einem gemeinsamen Cache, mit wenig freien Blcken, damit auch verdrngt wird
+	for (int run = 0; run < nRuns / 10 + 1; run++) {
+		typedef SharedFileCache<TYPE_OF_DATA> Cache_t;
+		Cache_t cache(disk, CACHE_LEN / 4, 6);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; i++) {
+			readers.emplace_back([&cache, run, i] {
+				Cache_t::Cursor cursor(cache);
+				MyTest(cursor);
+				NoisyTest(cursor, static_cast<unsigned int>(4 * run + i));
+				SeekTest(cursor, static_cast<unsigned int>(4 * run + i));
+			});
+		}
+		for (std::thread &reader : readers) {
+			reader.join();
+		}
+		CHECK(cache.stats().hits > 0);
+		cache.tearDown();
+	}
+	for (int run = 0; run < nRuns; run++) {
+		auto *p_testee = new MappedTestee_t(fd);
+		CHECK(p_testee->size() == N_ELEMENTS_IN_TESTFILE);
+		auto *p_listener = new MappedTestee_t::DefaultListener(*p_testee);
+		MyTest(*p_testee);
+		// An den Enden stehen bleiben mit END_OF_FILE und dem ersten bzw. letzten Element, wie der Buffer
+		TYPE_OF_DATA value{ -1 };
+		CHECK(p_testee->getPrev(value) == MappedTestee_t::CacheState_t::END_OF_FILE && value == 0);
+		while (step(*p_testee, true, value) != MappedTestee_t::CacheState_t::END_OF_FILE) {
+		}
+		value = -1;
+		CHECK(p_testee->getNext(value) == MappedTestee_t::CacheState_t::END_OF_FILE);
+		CHECK(value == static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1));
+		while (step(*p_testee, false, value) != MappedTestee_t::CacheState_t::END_OF_FILE) {
+		}
+		NoisyTest(*p_testee, static_cast<unsigned int>(run));
+		p_listener->tearDown();
+		delete p_listener;
+		delete p_testee;
+	}
+	close(fd);
+	printf("%d Durchlufe OK\n", nRuns);
+	return 0;
+}
@@ -2,7 +2,18 @@
 #include "CppUnitTest.h"
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+#define CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS 1
 #include "CircularBidirectionalFilereaderBuffer.hpp"
+#include "BlockCacheReadEngine.hpp"
+#include "CompressedReadEngine.hpp"
+#include "SharedFileCache.hpp"
+#include "SegmentedReadEngine.hpp"
+#include "StridedReadEngine.hpp"
+#include "MinMaxPyramid.hpp"
+#include "KeyIndex.hpp"
+#include "DecodingReadEngine.hpp"
+#include "AdaptivePrefetchPolicy.hpp"
+#include <random>
 
 static const size_t CACHE_LEN{ 1024u };
 /** testfile.bin muss Werte dieses Typs in aufsteigender Reihenfolge enthalten */
@@ -76,6 +87,837 @@ namespace UnitTest1
 			tearDown();
 		}
 
+		TEST_METHOD(Span) {
+			setup();
+			TestListener testListener(*p_testee_);
+			// Vorwaerts in Bloecken bis zum Dateiende, dann rueckwaerts bis zum Anfang.
+			Testee_t::Span_t span;
+			TYPE_OF_DATA expected{ 1 };
+			Testee_t::CacheState_t state = Testee_t::CacheState_t::OK;
+			while (state == Testee_t::CacheState_t::OK) {
+				state = p_testee_->getNextSpan(100, span);
+				Assert::IsTrue(span.size() <= CACHE_LEN / 4);
+				for (size_t i = 0; i < span.firstLength; i++) {
+					Assert::AreEqual<TYPE_OF_DATA>(expected++, span.first[i]);
+				}
+				for (size_t i = 0; i < span.secondLength; i++) {
+					Assert::AreEqual<TYPE_OF_DATA>(expected++, span.second[i]);
+				}
+			}
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, state);
+			Assert::AreEqual<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE, expected);
+			TYPE_OF_DATA value;
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1, value);
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getNextSpan(100, span));
+			Assert::AreEqual<size_t>(0u, span.size());
+
+			expected = N_ELEMENTS_IN_TESTFILE - 2;
+			state = Testee_t::CacheState_t::OK;
+			while (state == Testee_t::CacheState_t::OK) {
+				state = p_testee_->getPrevSpan(CACHE_LEN, span);
+				for (size_t i = span.secondLength; i > 0; i--) {
+					Assert::AreEqual<TYPE_OF_DATA>(expected--, span.second[i - 1]);
+				}
+				for (size_t i = span.firstLength; i > 0; i--) {
+					Assert::AreEqual<TYPE_OF_DATA>(expected--, span.first[i - 1]);
+				}
+			}
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, state);
+			Assert::AreEqual<TYPE_OF_DATA>(-1, expected);
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(0, value);
+			tearDown();
+		}
+
+		TEST_METHOD(Seek) {
+			setup();
+			TestListener testListener(*p_testee_);
+			TYPE_OF_DATA value;
+			// Im Cache: nur base_ verschieben
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(100));
+			Assert::AreEqual<size_t>(0u, p_testee_->bottom_);
+			Assert::AreEqual<size_t>(CACHE_LEN / 2, p_testee_->top_);
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(100, value);
+			Assert::AreEqual<size_t>(100u, p_testee_->position());
+			// Weit weg: je eine halbe Cache-Lnge davor und danach
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(5000));
+			Assert::AreEqual<size_t>(5000 - CACHE_LEN / 2, p_testee_->bottom_);
+			Assert::AreEqual<size_t>(5000 + CACHE_LEN / 2, p_testee_->top_);
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(5000, value);
+			Assert::AreEqual<size_t>(5000u, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getPrev(value));
+			Assert::AreEqual<TYPE_OF_DATA>(4999, value);
+			for (TYPE_OF_DATA expected = 5000; expected < 5000 + static_cast<TYPE_OF_DATA>(CACHE_LEN); expected++) {
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getNext(value));
+				Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+			}
+			// Am Dateiende abgeschnitten
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(N_ELEMENTS_IN_TESTFILE - 10));
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE, p_testee_->top_);
+			Assert::AreEqual(Testee_t::CacheState_t::CACHE_OVERFLOW, p_testee_->seek(N_ELEMENTS_IN_TESTFILE + 10));
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - 1, p_testee_->position());
+			// Zurck an den Anfang
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(3));
+			Assert::AreEqual<size_t>(0u, p_testee_->bottom_);
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(3, value);
+			tearDown();
+		}
+
+		TEST_METHOD(PrefetchPolicy) {
+			// Vorwrts-lastig: drei Viertel des Caches vor dem Lesezeiger
+			class ForwardPolicy : public IPrefetchPolicy {
+			public:
+				size_t fillThreshold(bool up, size_t capacity) const override { return up ? capacity / 2 : capacity / 8; }
+				size_t lookahead(size_t capacity) const override { return capacity / 4 * 3; }
+			} policy;
+			setup();
+			TestListener testListener(*p_testee_);
+			p_testee_->setPrefetchPolicy(&policy);
+			p_testee_->initialize();
+			Assert::AreEqual<size_t>(CACHE_LEN / 4 * 3, p_testee_->top_);
+			TYPE_OF_DATA value;
+			for (TYPE_OF_DATA expected = 1; expected <= static_cast<TYPE_OF_DATA>(CACHE_LEN / 4); expected++) {
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getNext(value));
+				Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+			}
+			Assert::AreEqual<size_t>(CACHE_LEN / 4 * 3, p_testee_->top_, L"noch nicht gefllt");
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getNext(value));
+			Assert::AreEqual<size_t>(CACHE_LEN, p_testee_->top_, L"bei der halben Cache-Lnge um ein Viertel gefllt");
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(5000));
+			Assert::AreEqual<size_t>(5000 - CACHE_LEN / 4, p_testee_->bottom_);
+			Assert::AreEqual<size_t>(5000 + CACHE_LEN / 4 * 3, p_testee_->top_);
+			tearDown();
+		}
+
+		TEST_METHOD(Stats) {
+			setup();
+			TestListener testListener(*p_testee_);
+			TYPE_OF_DATA value;
+			// Bei fillLevelUp = CACHE_LEN / 4 angefordert, aber erst unter der Schwelle gefllt
+			for (unsigned int i = 0; i < CACHE_LEN / 4 + 1; i++) {
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getNext(value));
+			}
+			Testee_t::Stats_t stats = p_testee_->stats();
+			Assert::AreEqual<uint64_t>(CACHE_LEN / 4 + 1, stats.states[static_cast<size_t>(Testee_t::CacheState_t::OK)]);
+			Assert::AreEqual<uint64_t>(0u, stats.states[static_cast<size_t>(Testee_t::CacheState_t::CACHE_OVERFLOW)]);
+			Assert::AreEqual<uint64_t>(1u, stats.fills[1]);
+			Assert::AreEqual<uint64_t>(1u, stats.rejectedFills[1]);
+			Assert::AreEqual<uint64_t>(0u, stats.fills[0]);
+			Assert::AreEqual<uint64_t>((CACHE_LEN / 2 + CACHE_LEN / 4) * sizeof(TYPE_OF_DATA), stats.bytesRead);
+			Assert::AreEqual<uint64_t>(0u, stats.seeks, L"der Fill liest dort weiter, wo initialize aufgehrt hat");
+			Assert::AreEqual<size_t>(CACHE_LEN / 4 - 1, stats.lowWater[1]);
+			Assert::AreEqual<size_t>(std::numeric_limits<size_t>::max(), stats.lowWater[0]);
+			Assert::AreEqual<uint64_t>(1u, stats.fillLatency.count());
+			Assert::IsTrue(stats.lockHold.count() >= 2);  // initialize und der Fill
+			Assert::IsTrue(stats.fillLatency.percentileNs(0.5) > 0);
+			// Im Cache und mit Neuaufbau
+			p_testee_->seek(100);
+			p_testee_->seek(5000);
+			stats = p_testee_->stats();
+			Assert::AreEqual<uint64_t>(2u, stats.seekCalls);
+			Assert::AreEqual<uint64_t>(1u, stats.rebuilds);
+			Assert::AreEqual<uint64_t>(1u, stats.seeks, L"nur der Neuaufbau positioniert neu");
+			// Abwrts vom Anfang des Neuaufbaus aus: jeder Fill positioniert neu
+			for (unsigned int i = 0; i < CACHE_LEN / 2; i++) {
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getPrev(value));
+			}
+			stats = p_testee_->stats();
+			Assert::IsTrue(stats.fills[0] >= 1);
+			Assert::AreEqual<uint64_t>(1u + stats.fills[0], stats.seeks);
+			tearDown();
+		}
+
+		TEST_METHOD(BlockCache) {
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine disk(f);
+			BlockCacheReadEngine engine(disk, CACHE_LEN / 4 * sizeof(TYPE_OF_DATA), 16);
+			p_testee_ = new Testee_t(engine);
+			TestListener testListener(*p_testee_);
+			TYPE_OF_DATA value;
+			TYPE_OF_DATA expected{ 0 };
+			for (unsigned int i = 0; i < CACHE_LEN; i++) {
+				p_testee_->getNext(value);
+				Assert::AreEqual<TYPE_OF_DATA>(++expected, value);
+			}
+			// Um eine Viertel-Grenze pendeln: jede Schwingung fllt abwrts und wieder aufwrts
+			for (int swing = 0; swing < 5; swing++) {
+				for (unsigned int i = 0; i < CACHE_LEN / 4 * 3; i++) {
+					p_testee_->getPrev(value);
+					Assert::AreEqual<TYPE_OF_DATA>(--expected, value);
+				}
+				for (unsigned int i = 0; i < CACHE_LEN / 4 * 3; i++) {
+					p_testee_->getNext(value);
+					Assert::AreEqual<TYPE_OF_DATA>(++expected, value);
+				}
+			}
+			const BlockCacheReadEngine::Stats_t stats = engine.stats();
+			Assert::IsTrue(stats.misses <= 8, L"jedes Viertel nur einmal von der Datei");
+			Assert::IsTrue(stats.hits >= 10, L"die Schwingungen kommen aus dem Block-Cache");
+			Assert::AreEqual<uint64_t>(stats.hits * CACHE_LEN / 4 * sizeof(TYPE_OF_DATA), stats.bytesFromCache);
+			tearDown();
+		}
+
+		TEST_METHOD(Blocking) {
+			using namespace std::chrono_literals;
+			DummyTestListener dummyListener;
+			setup();
+			p_testee_->setListener(&dummyListener);
+			TYPE_OF_DATA value;
+			p_testee_->seek(CACHE_LEN / 2 - 1);
+			// Es wird nie gefllt: nach dem Timeout CACHE_OVERFLOW, die Position bleibt
+			Assert::AreEqual(Testee_t::CacheState_t::CACHE_OVERFLOW, p_testee_->getNext(value, 10ms));
+			Assert::AreEqual<size_t>(CACHE_LEN / 2 - 1, p_testee_->position());
+			p_testee_->seek(0);
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getPrev(value, 10ms));
+			Assert::AreEqual<TYPE_OF_DATA>(0, value);
+
+			// Mit Fller-Thread ohne Polling vorwrts bis ans Dateiende und zurck
+			auto *p_listener = new Testee_t::DefaultListener(*p_testee_);
+			TYPE_OF_DATA expected{ 0 };
+			Testee_t::CacheState_t state = Testee_t::CacheState_t::OK;
+			while (state != Testee_t::CacheState_t::END_OF_FILE) {
+				state = p_testee_->getNext(value, 1s);
+				Assert::AreNotEqual(Testee_t::CacheState_t::CACHE_OVERFLOW, state);
+				if (state != Testee_t::CacheState_t::END_OF_FILE) {
+					Assert::AreEqual<TYPE_OF_DATA>(++expected, value);
+				}
+			}
+			Assert::AreEqual<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1, value);
+			expected = value;
+			state = Testee_t::CacheState_t::OK;
+			while (state != Testee_t::CacheState_t::END_OF_FILE) {
+				state = p_testee_->getPrev(value, 1s);
+				Assert::AreNotEqual(Testee_t::CacheState_t::CACHE_OVERFLOW, state);
+				if (state != Testee_t::CacheState_t::END_OF_FILE) {
+					Assert::AreEqual<TYPE_OF_DATA>(--expected, value);
+				}
+			}
+			Assert::AreEqual<TYPE_OF_DATA>(0, value);
+			p_listener->tearDown();
+			delete p_listener;
+			tearDown();
+		}
+
+		TEST_METHOD(SharedCursors) {
+			typedef SharedFileCache<TYPE_OF_DATA> Cache_t;
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine engine(f);
+			Cache_t *p_cache = new Cache_t(engine, CACHE_LEN / 4, 8);
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE, p_cache->size());
+			{
+				// Zwei Cursor im Gleichschritt: jeder Block wird nur einmal gelesen
+				Cache_t::Cursor first(*p_cache);
+				Cache_t::Cursor second(*p_cache);
+				TYPE_OF_DATA value;
+				for (TYPE_OF_DATA expected = 1; expected < static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE); expected++) {
+					const bool last = expected == static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1);
+					Assert::IsTrue((first.getNext(value) == Cache_t::CacheState_t::END_OF_FILE) == last);
+					Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+					Assert::IsTrue((second.getNext(value) == Cache_t::CacheState_t::END_OF_FILE) == last);
+					Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+				}
+				Assert::IsTrue(first.getNext(value) == Cache_t::CacheState_t::END_OF_FILE);
+				Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - 1, first.position());
+				Cache_t::Stats_t stats = p_cache->stats();
+				Assert::AreEqual<uint64_t>(N_ELEMENTS_IN_TESTFILE / (CACHE_LEN / 4), stats.loads);
+
+				// Ein dritter Cursor rckwrts, unabhngig von den beiden anderen
+				Cache_t::Cursor third(*p_cache, N_ELEMENTS_IN_TESTFILE / 2);
+				third.getCurrent(value);
+				Assert::AreEqual<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE / 2, value);
+				for (TYPE_OF_DATA expected = N_ELEMENTS_IN_TESTFILE / 2 - 1; expected >= 0; expected--) {
+					Assert::IsTrue((third.getPrev(value) == Cache_t::CacheState_t::END_OF_FILE) == (expected == 0));
+					Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+				}
+				Assert::IsTrue(second.seek(N_ELEMENTS_IN_TESTFILE) == Cache_t::CacheState_t::CACHE_OVERFLOW);
+				Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - 1, second.position());
+				Assert::IsTrue(second.seek(100) == Cache_t::CacheState_t::OK);
+				second.getCurrent(value);
+				Assert::AreEqual<TYPE_OF_DATA>(100, value);
+			}
+			// Ohne Cursor bleiben hchstens maxIdleBlocks
+			Assert::IsTrue(p_cache->stats().residentBlocks <= 8);
+			p_cache->tearDown();
+			delete p_cache;
+			fclose(f);
+		}
+
+		TEST_METHOD(Compressed) {
+			// testfile.bin komprimieren, Blcke bewusst nicht auf den Viertelsgrenzen des Caches
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			FILE *compressed;
+			err = fopen_s(&compressed, "testfile.cbfz", "w+b");
+			Assert::AreEqual(0, err);
+			CompressedFormat::Writer writer(compressed, sizeof(TYPE_OF_DATA), CACHE_LEN / 4 - 3);
+			TYPE_OF_DATA raw[1000];
+			size_t n;
+			while ((n = fread(raw, sizeof(TYPE_OF_DATA), 1000, f)) > 0) {
+				Assert::IsTrue(writer.write(raw, n));
+			}
+			Assert::IsTrue(writer.finish());
+			fclose(f);
+			f = compressed;
+			Assert::IsTrue(writer.bytesWritten() < N_ELEMENTS_IN_TESTFILE * sizeof(TYPE_OF_DATA) / 3);
+
+			StdioReadEngine disk(compressed);
+			CompressedReadEngine engine(disk);
+			Assert::IsTrue(engine.isValid());
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE, engine.size(sizeof(TYPE_OF_DATA)));
+			p_testee_ = new Testee_t(engine);
+			TestListener testListener(*p_testee_);
+			MyTest();
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(5000));
+			TYPE_OF_DATA value;
+			for (TYPE_OF_DATA expected = 4999; expected > 5000 - static_cast<TYPE_OF_DATA>(CACHE_LEN); expected--) {
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getPrev(value));
+				Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+			}
+
+			// Keine komprimierte Datei
+			FILE *rawFile;
+			err = fopen_s(&rawFile, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine rawDisk(rawFile);
+			CompressedReadEngine invalid(rawDisk);
+			Assert::IsFalse(invalid.isValid());
+			Assert::AreEqual<size_t>(0u, invalid.size(sizeof(TYPE_OF_DATA)));
+			fclose(rawFile);
+			tearDown();
+			remove("testfile.cbfz");
+		}
+
+		TEST_METHOD(Follow) {
+			using namespace std::chrono_literals;
+			FILE *writer;
+			errno_t err = fopen_s(&writer, "follow.bin", "wb");
+			Assert::AreEqual(0, err);
+			TYPE_OF_DATA next{ 0 };
+			auto append = [&writer, &next](int n) {
+				for (int i = 0; i < n; i++, next++) {
+					fwrite(&next, sizeof(TYPE_OF_DATA), 1, writer);
+				}
+				fflush(writer);
+			};
+			append(100);
+			err = fopen_s(&f, "follow.bin", "rb");
+			Assert::AreEqual(0, err);
+			p_testee_ = new Testee_t(f);
+			TestListener testListener(*p_testee_);
+			p_testee_->setFollow(true);
+			TYPE_OF_DATA value;
+			TYPE_OF_DATA expected{ 0 };
+			while (p_testee_->getNext(value) != Testee_t::CacheState_t::END_OF_FILE) {
+				Assert::AreEqual<TYPE_OF_DATA>(++expected, value);
+			}
+			Assert::AreEqual<TYPE_OF_DATA>(99, value);
+			// Ohne neue Daten bleibt es beim Dateiende, auch blockierend
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getNext(value));
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getNext(value, 10ms));
+			Assert::AreEqual<size_t>(99u, p_testee_->position());
+
+			// Angehngte Elemente kommen mit dem nchsten Fill, auch ber mehrere Viertel. Das nicht blockierende getNext
+			// fordert am Dateiende nur den Fill an, das blockierende wartet ihn ab.
+			append(CACHE_LEN);
+			expected = 99;
+			while (p_testee_->getNext(value, 10ms) != Testee_t::CacheState_t::END_OF_FILE) {
+				Assert::AreEqual<TYPE_OF_DATA>(++expected, value);
+			}
+			Assert::AreEqual<TYPE_OF_DATA>(99 + CACHE_LEN, value);
+
+			// Ein halb geschriebenes Element wird erst gelesen, wenn es vollstndig ist
+			const char *bytes = reinterpret_cast<const char *>(&next);
+			fwrite(bytes, 1, 2, writer);
+			fflush(writer);
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getNext(value));
+			Assert::AreEqual<TYPE_OF_DATA>(99 + CACHE_LEN, value);
+			// Das Element 100 im Platz des halben ist nicht berschrieben worden
+			for (expected = 98 + CACHE_LEN; expected >= 100; expected--) {
+				p_testee_->getPrev(value);
+				Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+			}
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(99 + CACHE_LEN));
+			fwrite(bytes + 2, 1, sizeof(TYPE_OF_DATA) - 2, writer);
+			next++;
+			fflush(writer);
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getNext(value, 10ms));
+			Assert::AreEqual<TYPE_OF_DATA>(100 + CACHE_LEN, value);
+			fclose(writer);
+			tearDown();
+			remove("follow.bin");
+		}
+
+		TEST_METHOD(Segmented) {
+			// testfile.bin in drei Segmente teilen, die Grenzen mitten in Elementen
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			const size_t segmentBytes[3]{ 3000 * sizeof(TYPE_OF_DATA) + 1, 2500 * sizeof(TYPE_OF_DATA) + 2, N_ELEMENTS_IN_TESTFILE * sizeof(TYPE_OF_DATA) };
+			const char *segmentNames[3]{ "testfile.bin.000", "testfile.bin.001", "testfile.bin.002" };
+			std::vector<char> bytes(N_ELEMENTS_IN_TESTFILE * sizeof(TYPE_OF_DATA));
+			for (int i = 0; i < 3; i++) {
+				FILE *segment;
+				err = fopen_s(&segment, segmentNames[i], "wb");
+				Assert::AreEqual(0, err);
+				const size_t n = fread(bytes.data(), 1, segmentBytes[i], f);
+				Assert::AreEqual(n, fwrite(bytes.data(), 1, n, segment));
+				fclose(segment);
+			}
+
+			{
+				SegmentedReadEngine engine(SegmentedReadEngine::numberedSegments("testfile.bin"), 2);
+				Assert::AreEqual<size_t>(3u, engine.segmentCount());
+				Assert::AreEqual<size_t>(0u, engine.openFiles());
+				Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE, engine.size(sizeof(TYPE_OF_DATA)));
+				// Ein Element ber der Grenze
+				TYPE_OF_DATA value;
+				Assert::AreEqual<size_t>(1u, engine.read(&value, sizeof(TYPE_OF_DATA), 1, 3000));
+				Assert::AreEqual<TYPE_OF_DATA>(3000, value);
+				Assert::AreEqual<size_t>(2u, engine.openFiles());
+
+				p_testee_ = new Testee_t(engine);
+				TestListener testListener(*p_testee_);
+				MyTest();
+				Assert::IsTrue(engine.openFiles() <= 2u);
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(5600));
+				for (TYPE_OF_DATA expected = 5599; expected > 5600 - static_cast<TYPE_OF_DATA>(CACHE_LEN); expected--) {
+					Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getPrev(value));
+					Assert::AreEqual<TYPE_OF_DATA>(expected, value);
+				}
+				Assert::AreEqual(Testee_t::CacheState_t::CACHE_OVERFLOW, p_testee_->seek(N_ELEMENTS_IN_TESTFILE + 10));
+				p_testee_->getCurrent(value);
+				Assert::AreEqual<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1, value);
+				tearDown();
+			}
+			for (const char *name : segmentNames) {
+				remove(name);
+			}
+		}
+
+		TEST_METHOD(Strided) {
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine disk(f);
+			// Jedes dritte ab 1: am Stck gelesen bzw. (denseBytes 0) jedes einzeln
+			for (size_t denseBytes : { size_t{ 4096 }, size_t{ 0 } }) {
+				StridedReadEngine engine(disk, 3, 1, denseBytes);
+				const size_t n = (N_ELEMENTS_IN_TESTFILE - 2) / 3 + 1;
+				Assert::AreEqual(n, engine.size(sizeof(TYPE_OF_DATA)));
+				p_testee_ = new Testee_t(engine);
+				TestListener testListener(*p_testee_);
+				TYPE_OF_DATA value;
+				p_testee_->getCurrent(value);
+				Assert::AreEqual<TYPE_OF_DATA>(1, value);
+				for (size_t i = 1; i < n; i++) {
+					p_testee_->getNext(value);
+					Assert::AreEqual<TYPE_OF_DATA>(static_cast<TYPE_OF_DATA>(1 + 3 * i), value);
+				}
+				Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->getNext(value));
+				for (size_t i = n - 1; i > 0; i--) {
+					p_testee_->getPrev(value);
+					Assert::AreEqual<TYPE_OF_DATA>(static_cast<TYPE_OF_DATA>(1 + 3 * (i - 1)), value);
+				}
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(2000));
+				p_testee_->getCurrent(value);
+				Assert::AreEqual<TYPE_OF_DATA>(6001, value);
+				delete p_testee_;
+			}
+			// Weit auseinander: nur die gebrauchten Elemente
+			StridedReadEngine sparse(disk, 1500);
+			Assert::AreEqual<size_t>(6u, sparse.size(sizeof(TYPE_OF_DATA)));
+			TYPE_OF_DATA values[8];
+			Assert::AreEqual<size_t>(5u, sparse.read(values, sizeof(TYPE_OF_DATA), 8, 1));
+			Assert::AreEqual<TYPE_OF_DATA>(1500, values[0]);
+			Assert::AreEqual<TYPE_OF_DATA>(7500, values[4]);
+			fclose(f);
+		}
+
+		TEST_METHOD(Pyramid) {
+			using namespace std::chrono_literals;
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine source(f);
+			// Faktor 3: die Lnge ist kein Vielfaches, die letzten Eintrge der Stufen sind unvollstndig
+			const size_t factor = 3;
+			remove("testfile.pyr");
+			{
+				PyramidBuilder<TYPE_OF_DATA> builder(source, "testfile.pyr", factor, 1000);
+				Assert::IsTrue(builder.isValid());
+				Assert::IsTrue(builder.waitForCompletion(5s));
+				Assert::AreEqual(9u, builder.levels());
+				builder.tearDown();
+			}
+			{
+				// Schon fertig: wird nicht neu gebaut
+				PyramidBuilder<TYPE_OF_DATA> builder(source, "testfile.pyr", factor, 1000);
+				Assert::IsTrue(builder.isComplete());
+				builder.tearDown();
+			}
+			FILE *sidecar;
+			err = fopen_s(&sidecar, "testfile.pyr", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine sidecarEngine(sidecar);
+			auto check = [](const PyramidEntry_t<TYPE_OF_DATA> &entry, size_t i, uint64_t span) {
+				const TYPE_OF_DATA first = static_cast<TYPE_OF_DATA>(i * span);
+				const TYPE_OF_DATA last = static_cast<TYPE_OF_DATA>(std::min<uint64_t>((i + 1) * span, N_ELEMENTS_IN_TESTFILE) - 1);
+				Assert::AreEqual(first, entry.min);
+				Assert::AreEqual(last, entry.max);
+				Assert::AreEqual((first + last) / 2.0, entry.mean, 1e-9);
+			};
+			for (unsigned int level = 2; level <= 9; level++) {
+				PyramidReadEngine engine(sidecarEngine, level);
+				Assert::IsTrue(engine.isValid());
+				const size_t n = engine.size(sizeof(PyramidEntry_t<TYPE_OF_DATA>));
+				Assert::AreEqual<size_t>((N_ELEMENTS_IN_TESTFILE + engine.span() - 1) / engine.span(), n);
+				std::vector<PyramidEntry_t<TYPE_OF_DATA>> entries(n + 1);
+				Assert::AreEqual(n, engine.read(entries.data(), sizeof(PyramidEntry_t<TYPE_OF_DATA>), n + 1, 0));
+				for (size_t i = 0; i < n; i++) {
+					check(entries[i], i, engine.span());
+				}
+			}
+			Assert::IsFalse(PyramidReadEngine(sidecarEngine, 10).isValid());
+			Assert::AreEqual(4u, PyramidFormat::levelFor(N_ELEMENTS_IN_TESTFILE, 100, factor, 9));
+
+			// Stufe 1 mit einem Buffer, lnger als der Cache
+			typedef CircularBidirectionalFilereaderBuffer<PyramidEntry_t<TYPE_OF_DATA>, CACHE_LEN> Level_t;
+			PyramidReadEngine level1(sidecarEngine, 1);
+			const size_t n = (N_ELEMENTS_IN_TESTFILE + factor - 1) / factor;
+			Assert::AreEqual(n, level1.size(sizeof(PyramidEntry_t<TYPE_OF_DATA>)));
+			Level_t overview(level1);
+			Level_t::DefaultListener listener(overview);
+			PyramidEntry_t<TYPE_OF_DATA> entry;
+			overview.getCurrent(entry);
+			check(entry, 0, factor);
+			for (size_t i = 1; i < n; i++) {
+				Assert::IsTrue(overview.getNext(entry, 1s) != Level_t::CacheState_t::CACHE_OVERFLOW);
+				check(entry, i, factor);
+			}
+			for (size_t i = n - 1; i > 0; i--) {
+				Assert::IsTrue(overview.getPrev(entry, 1s) != Level_t::CacheState_t::CACHE_OVERFLOW);
+				check(entry, i - 1, factor);
+			}
+			Assert::IsTrue(overview.seek(n - 1) == Level_t::CacheState_t::OK);
+			overview.getCurrent(entry);
+			check(entry, n - 1, factor);
+			listener.tearDown();
+			fclose(sidecar);
+			fclose(f);
+			remove("testfile.pyr");
+		}
+
+		TEST_METHOD(SeekToKey) {
+			/** Zhlt die Lesevorgnge */
+			struct CountingEngine : public StdioReadEngine {
+				CountingEngine(FILE *file) : StdioReadEngine(file) {}
+				virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+					reads++;
+					return StdioReadEngine::read(dest, elementSize, count, first);
+				}
+				size_t reads{ 0 };
+			};
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			CountingEngine engine(f);
+			p_testee_ = new Testee_t(engine);
+			TestListener testListener(*p_testee_);
+			auto identity = [](const TYPE_OF_DATA &value) { return value; };
+			TYPE_OF_DATA value;
+
+			// Ausserhalb des Caches: O(log n) einzelne Elemente, dann der Neuaufbau
+			size_t reads = engine.reads;
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seekToKey(6000, identity));
+			Assert::AreEqual<size_t>(6000u, p_testee_->position());
+			Assert::IsTrue(engine.reads - reads <= 2 * 13 + 2);
+			// Die Nachbarn und nahe Schlssel sind im Cache
+			reads = engine.reads;
+			p_testee_->getNext(value);
+			Assert::AreEqual<TYPE_OF_DATA>(6001, value);
+			p_testee_->getPrev(value);
+			p_testee_->getPrev(value);
+			Assert::AreEqual<TYPE_OF_DATA>(5999, value);
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seekToKey(6100, identity));
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(6100, value);
+			Assert::AreEqual(reads, engine.reads);
+
+			// Mehrfache Schlssel: das erste passende Element. Schlssel zwischen zwei Elementen: das nchste.
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seekToKey(123, [](const TYPE_OF_DATA &v) { return v / 10; }));
+			Assert::AreEqual<size_t>(1230u, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seekToKey(2500.5, [](const TYPE_OF_DATA &v) { return static_cast<double>(v); }));
+			Assert::AreEqual<size_t>(2501u, p_testee_->position());
+			// Rnder
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seekToKey(-5, identity));
+			Assert::AreEqual<size_t>(0u, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::CACHE_OVERFLOW, p_testee_->seekToKey(100000, identity));
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - 1, p_testee_->position());
+
+			// Mit KeyIndex: bekannte Blockschlssel, danach nur noch der Neuaufbau
+			FILE *indexFile;
+			err = fopen_s(&indexFile, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine indexDisk(indexFile);
+			KeyIndex<TYPE_OF_DATA, TYPE_OF_DATA, decltype(identity)> index(indexDisk, identity, CACHE_LEN / 4);
+			reads = engine.reads;
+			Assert::AreEqual(Testee_t::CacheState_t::OK, index.seek(*p_testee_, 3333));
+			Assert::AreEqual<size_t>(3333u, p_testee_->position());
+			Assert::IsTrue(engine.reads - reads <= 2);
+			Assert::IsTrue(index.reads() <= 6);
+			const size_t indexReads = index.reads();
+			index.seek(*p_testee_, 3400);
+			Assert::AreEqual<size_t>(3400u, p_testee_->position());
+			Assert::AreEqual(indexReads, index.reads());
+			index.build();
+			Assert::IsTrue(index.save("testfile.idx"));
+			KeyIndex<TYPE_OF_DATA, TYPE_OF_DATA, decltype(identity)> loaded(indexDisk, identity, CACHE_LEN / 4);
+			Assert::IsTrue(loaded.load("testfile.idx"));
+			Assert::AreEqual(Testee_t::CacheState_t::OK, loaded.seek(*p_testee_, 7000));
+			Assert::AreEqual<size_t>(7000u, p_testee_->position());
+			Assert::AreEqual<size_t>(0u, loaded.reads());
+			KeyIndex<TYPE_OF_DATA, TYPE_OF_DATA, decltype(identity)> otherBlocks(indexDisk, identity, 100);
+			Assert::IsFalse(otherBlocks.load("testfile.idx"));
+			fclose(indexFile);
+			remove("testfile.idx");
+			tearDown();
+		}
+
+		TEST_METHOD(Decode) {
+			using namespace std::chrono_literals;
+			// Kernels: Lngen, die nicht in ganze Vektoren aufgehen, damit auch der skalare Rest luft
+			for (size_t n = 0; n < 70; n++) {
+				std::vector<uint8_t> in(8 * n);
+				for (size_t b = 0; b < in.size(); b++) {
+					in[b] = static_cast<uint8_t>(b * 7 + 3);
+				}
+				std::vector<uint8_t> out(in.size());
+				for (size_t word : { 2, 4, 8 }) {
+					switch (word) {
+					case 2: DecodeKernels::byteSwap<2>(in.data(), out.data(), 4 * n); break;
+					case 4: DecodeKernels::byteSwap<4>(in.data(), out.data(), 2 * n); break;
+					default: DecodeKernels::byteSwap<8>(in.data(), out.data(), n); break;
+					}
+					for (size_t b = 0; b < in.size(); b++) {
+						Assert::AreEqual(in[b / word * word + word - 1 - b % word], out[b]);
+					}
+				}
+
+				std::vector<int16_t> samples(n);
+				for (size_t i = 0; i < n; i++) {
+					samples[i] = static_cast<int16_t>(i * 997 - 32768);
+				}
+				std::vector<float> floats(n);
+				DecodeKernels::int16ToFloat(samples.data(), floats.data(), n, 0.5f, -1.0f, false);
+				for (size_t i = 0; i < n; i++) {
+					Assert::AreEqual(samples[i] * 0.5f - 1.0f, floats[i]);
+				}
+				DecodeKernels::byteSwap<2>(samples.data(), samples.data(), n);
+				DecodeKernels::int16ToFloat(samples.data(), floats.data(), n, 0.5f, -1.0f, true);
+				DecodeKernels::byteSwap<2>(samples.data(), samples.data(), n);
+				for (size_t i = 0; i < n; i++) {
+					Assert::AreEqual(samples[i] * 0.5f - 1.0f, floats[i]);
+				}
+
+				for (size_t channels = 1; channels <= 5; channels++) {
+					std::vector<uint16_t> records16(n * channels);
+					std::vector<uint32_t> records32(n * channels);
+					for (size_t k = 0; k < n * channels; k++) {
+						records16[k] = static_cast<uint16_t>(k * 40503u);
+						records32[k] = static_cast<uint32_t>(k * 2654435761u);
+					}
+					std::vector<std::vector<uint16_t>> fields16(channels, std::vector<uint16_t>(n));
+					std::vector<std::vector<uint32_t>> fields32(channels, std::vector<uint32_t>(n));
+					void *out16[5];
+					void *out32[5];
+					for (size_t c = 0; c < channels; c++) {
+						out16[c] = fields16[c].data();
+						out32[c] = fields32[c].data();
+					}
+					DecodeKernels::deinterleave<2>(records16.data(), channels, n, out16);
+					DecodeKernels::deinterleave<4>(records32.data(), channels, n, out32);
+					for (size_t i = 0; i < n; i++) {
+						for (size_t c = 0; c < channels; c++) {
+							Assert::AreEqual(records16[i * channels + c], fields16[c][i]);
+							Assert::AreEqual(records32[i * channels + c], fields32[c][i]);
+						}
+					}
+				}
+			}
+
+			// Byte-Reihenfolge umgekehrt, mit MyTest durch den Buffer
+			errno_t err = fopen_s(&f, "testfile.bin", "rb");
+			Assert::AreEqual(0, err);
+			StdioReadEngine disk(f);
+			auto swapped = [](TYPE_OF_DATA value) {
+				DecodeKernels::byteSwap<sizeof(TYPE_OF_DATA)>(&value, &value, 1);
+				return value;
+			};
+			DecodingReadEngine<TYPE_OF_DATA, TYPE_OF_DATA, ByteSwapTransform<TYPE_OF_DATA>> swapping(disk);
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE, swapping.size(sizeof(TYPE_OF_DATA)));
+			p_testee_ = new Testee_t(swapping);
+			TestListener testListener(*p_testee_);
+			TYPE_OF_DATA value;
+			p_testee_->getCurrent(value);
+			Assert::AreEqual<TYPE_OF_DATA>(0, value);
+			for (TYPE_OF_DATA i = 1; i < static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE); i++) {
+				p_testee_->getNext(value);
+				Assert::AreEqual(swapped(i), value);
+			}
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->seek(5000));
+			for (TYPE_OF_DATA i = 4999; i > 5000 - static_cast<TYPE_OF_DATA>(CACHE_LEN); i--) {
+				Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getPrev(value));
+				Assert::AreEqual(swapped(i), value);
+			}
+			delete p_testee_;
+
+			// Anderer Typ im Cache: jedes TYPE_OF_DATA als zwei int16, skaliert zu zwei float
+			struct Pair_t {
+				float low;
+				float high;
+			};
+			typedef CircularBidirectionalFilereaderBuffer<Pair_t, CACHE_LEN> PairBuffer_t;
+			DecodingReadEngine<TYPE_OF_DATA, Pair_t, Int16ToFloatTransform<TYPE_OF_DATA, Pair_t>> scaling(disk, { 0.5f, 1.0f });
+			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE, scaling.size(sizeof(Pair_t)));
+			PairBuffer_t pairs(scaling);
+			PairBuffer_t::DefaultListener listener(pairs);
+			Pair_t pair;
+			pairs.getCurrent(pair);
+			Assert::AreEqual(1.0f, pair.low);
+			for (size_t i = 1; i < N_ELEMENTS_IN_TESTFILE; i++) {
+				Assert::IsTrue(pairs.getNext(pair, 1s) != PairBuffer_t::CacheState_t::CACHE_OVERFLOW);
+				Assert::AreEqual(i * 0.5f + 1.0f, pair.low);
+				Assert::AreEqual(1.0f, pair.high);
+			}
+			for (size_t i = N_ELEMENTS_IN_TESTFILE - 1; i > N_ELEMENTS_IN_TESTFILE - 2 * CACHE_LEN; i--) {
+				Assert::IsTrue(pairs.getPrev(pair, 1s) != PairBuffer_t::CacheState_t::CACHE_OVERFLOW);
+				Assert::AreEqual((i - 1) * 0.5f + 1.0f, pair.low);
+			}
+			listener.tearDown();
+			fclose(f);
+		}
+
+		TEST_METHOD(FindAndReduce) {
+			// Kernels gegen die einfache Schleife, mit Lngen, die nicht in ganze Vektoren aufgehen
+			std::mt19937 random{ 17 };
+			auto checkKernels = [&random](auto zero) {
+				typedef decltype(zero) V;
+				std::uniform_int_distribution<int> values{ -100, 100 };
+				for (size_t n = 0; n < 80; n++) {
+					std::vector<V> p(n);
+					for (V &v : p) {
+						v = static_cast<V>(values(random));
+					}
+					for (int t : { -101, -90, 0, 50, 99, 100 }) {
+						const V threshold = static_cast<V>(t);
+						for (bool forward : { true, false }) {
+							const size_t above = SpanKernels::find(p.data(), n, SpanKernels::Above<V>{ threshold }, forward);
+							const size_t below = SpanKernels::find(p.data(), n, SpanKernels::Below<V>{ threshold }, forward);
+							Assert::AreEqual(SpanKernels::find(p.data(), n, [threshold](const V &v) { return v > threshold; }, forward), above);
+							Assert::AreEqual(SpanKernels::find(p.data(), n, [threshold](const V &v) { return v < threshold; }, forward), below);
+						}
+					}
+					SpanSummary_t<V> summary;
+					SpanKernels::reduce(p.data(), n, summary);
+					Assert::AreEqual(n, summary.count);
+					if (n > 0) {
+						typename SpanSummary_t<V>::Sum_t sum{};
+						for (const V &v : p) {
+							sum += static_cast<typename SpanSummary_t<V>::Sum_t>(v);
+						}
+						Assert::IsTrue(sum == summary.sum);
+						Assert::IsTrue(*std::min_element(p.begin(), p.end()) == summary.min);
+						Assert::IsTrue(*std::max_element(p.begin(), p.end()) == summary.max);
+					}
+				}
+			};
+			checkKernels(0.0f);
+			checkKernels(0.0);
+			checkKernels(int8_t{});
+			checkKernels(uint8_t{});
+			checkKernels(int16_t{});
+			checkKernels(uint16_t{});
+			checkKernels(int32_t{});
+			checkKernels(uint32_t{});
+			checkKernels(int64_t{});
+			checkKernels(uint64_t{});
+
+			// ber den Buffer, weit genug, dass die Spans ber das Ende des Rings gehen
+			setup();
+			TestListener testListener(*p_testee_);
+			TYPE_OF_DATA value;
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->findNext(SpanKernels::Above<TYPE_OF_DATA>{ 5000 }, value));
+			Assert::AreEqual<TYPE_OF_DATA>(5001, value);
+			Assert::AreEqual<size_t>(5001u, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->findNext([](const TYPE_OF_DATA &v) { return v % 1000 == 999; }, value));
+			Assert::AreEqual<TYPE_OF_DATA>(5999, value);
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getNext(value));
+			Assert::AreEqual<TYPE_OF_DATA>(6000, value);
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->findPrev(SpanKernels::Below<TYPE_OF_DATA>{ 100 }, value));
+			Assert::AreEqual<TYPE_OF_DATA>(99, value);
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getPrev(value));
+			Assert::AreEqual<TYPE_OF_DATA>(98, value);
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->findNext(SpanKernels::Above<TYPE_OF_DATA>{ 100000 }, value));
+			Assert::AreEqual(static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1), value);
+			Assert::AreEqual(N_ELEMENTS_IN_TESTFILE - 1, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->findPrev(SpanKernels::Below<TYPE_OF_DATA>{ 0 }, value));
+			Assert::AreEqual<TYPE_OF_DATA>(0, value);
+
+			SpanSummary_t<TYPE_OF_DATA> summary;
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->reduceNext(3000, summary));
+			Assert::AreEqual<size_t>(3000u, summary.count);
+			Assert::AreEqual<int64_t>(3000 * 3001 / 2, summary.sum);
+			Assert::AreEqual<TYPE_OF_DATA>(1, summary.min);
+			Assert::AreEqual<TYPE_OF_DATA>(3000, summary.max);
+			Assert::AreEqual<size_t>(3000u, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->reducePrev(1000, summary));
+			Assert::AreEqual<int64_t>((2000 + 2999) * 1000 / 2, summary.sum);
+			Assert::AreEqual<size_t>(2000u, p_testee_->position());
+			Assert::AreEqual(Testee_t::CacheState_t::END_OF_FILE, p_testee_->reduceNext(100000, summary));
+			Assert::AreEqual(N_ELEMENTS_IN_TESTFILE - 1 - 2000, summary.count);
+			Assert::AreEqual(static_cast<TYPE_OF_DATA>(N_ELEMENTS_IN_TESTFILE - 1), summary.max);
+			tearDown();
+		}
+
+		TEST_METHOD(FindLikeForwardRead) {
+			// Ein Treffer von findNext ist fr Policy und Statistik ein Vorwrts-Lesen des Spans, kein Zurckgehen
+			auto readForward = [this](bool find, AdaptivePrefetchPolicy &policy) {
+				setup();
+				TestListener testListener(*p_testee_);
+				p_testee_->setPrefetchPolicy(&policy);
+				p_testee_->initialize();
+				if (find) {
+					TYPE_OF_DATA value;
+					Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->findNext(SpanKernels::Above<TYPE_OF_DATA>{ 100 }, value));
+					Assert::AreEqual<TYPE_OF_DATA>(101, value);
+					Assert::AreEqual<size_t>(101u, p_testee_->position());
+				} else {
+					Testee_t::Span_t span;
+					Assert::AreEqual(Testee_t::CacheState_t::OK, p_testee_->getNextSpan(CACHE_LEN / 4, span));
+				}
+				const Testee_t::Stats_t stats = p_testee_->stats();
+				tearDown();
+				return stats;
+			};
+			AdaptivePrefetchPolicy readPolicy;
+			AdaptivePrefetchPolicy findPolicy;
+			const Testee_t::Stats_t read = readForward(false, readPolicy);
+			const Testee_t::Stats_t found = readForward(true, findPolicy);
+			Assert::AreEqual(readPolicy.directionBias(), findPolicy.directionBias());
+			for (size_t state = 0; state < 4; state++) {
+				Assert::AreEqual(read.states[state], found.states[state]);
+			}
+			for (size_t up = 0; up < 2; up++) {
+				Assert::AreEqual(read.fills[up], found.fills[up]);
+				Assert::AreEqual(read.rejectedFills[up], found.rejectedFills[up]);
+			}
+			Assert::AreEqual(read.bytesRead, found.bytesRead);
+			Assert::AreEqual(read.seeks, found.seeks);
+			Assert::AreEqual<uint64_t>(0u, found.seekCalls);
+		}
+
 	private:
 
 		static const size_t N_ELEMENTS_IN_TESTFILE{ 8192u };
@@ -137,8 +979,9 @@ namespace UnitTest1
 			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - CACHE_LEN, p_testee_->bottom_, L"Inzwischen wurde nicht gefllt");
 			// Das data_-Array enthlt die <CACHE_LEN> hchsten Werte:
 			// Beim nchsten sollte unten aufgefllt werden
+			const size_t fills = p_testee_->fillCount();
 			state = p_testee_->getPrev(newValue);
-			std::this_thread::sleep_for(10ms);  // TODO saubere Synchronisation
+			Assert::IsTrue(p_testee_->waitForFill(fills, 1s));
 			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - CACHE_LEN - CACHE_LEN / 4, p_testee_->bottom_, L"bottom_ um einen Viertel runtergewandert");
 			Assert::AreEqual<size_t>(N_ELEMENTS_IN_TESTFILE - CACHE_LEN / 4, p_testee_->top_);
 			Assert::AreEqual<TYPE_OF_DATA>(newValue + 1, value);
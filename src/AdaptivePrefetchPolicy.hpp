@@ -0,0 +1,102 @@
+
+#ifndef ADAPTIVEPREFETCHPOLICY_HPP_
+#define ADAPTIVEPREFETCHPOLICY_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * IPrefetchPolicy, die sich der Leserichtung und dem Lesetempo anpasst.
+ *
+ * Die Richtungs-Tendenz ist ein gleitender Mittelwert ber die Lesezugriffe (1: nur aufwrts, 0: nur abwrts). Danach
+ * wird der Cache aufgeteilt: bei ausgeglichenem Lesen wie die feste Viertel-Regel je die Hlfte vor und hinter dem
+ * Lesezeiger, bei reinem Vorwrtslesen drei Viertel davor. Schwelle und Fill-Grsse teilen sich den Anteil einer Richtung
+ * je zur Hlfte; in der bevorzugten Richtung wird also frher und mehr gefllt.
+ *
+ * Das Tempo wird pro Richtung bei jedem Fill gemessen: gelesene Elemente seit dem letzten Fill und Dauer des Fills.
+ * Die Schwelle wird so weit angehoben, dass der Leser whrend (einem Mehrfachen) der Fill-Dauer nicht leer luft.
+ * Das fngt Burst-Lesen ab, das sonst ALMOST_EMPTY bringt.
+ *
+ * Eine Instanz pro Buffer. onRead kommt vom Leser, onFill vom Fller; ausgetauscht wird ber relaxed Atomics.
+ */
+class AdaptivePrefetchPolicy : public IPrefetchPolicy {
+public:
+
+    /**
+     * @param safetyFactor Die Schwelle deckt safetyFactor Fill-Dauern beim gemessenen Tempo
+     */
+    AdaptivePrefetchPolicy(unsigned int safetyFactor = 4) : safetyFactor_(safetyFactor) {}
+
+    virtual size_t fillThreshold(bool up, size_t capacity) const override {
+        const size_t byShare = capacity * share(up) / ONE / 2;
+        return std::max(byShare, neededAhead_[up].load(std::memory_order_relaxed));
+    }
+
+    virtual size_t fillSize(bool up, size_t capacity) const override {
+        return capacity * share(up) / ONE / 2;
+    }
+
+    virtual size_t lookahead(size_t capacity) const override {
+        return capacity * share(true) / ONE;
+    }
+
+    virtual void onRead(bool up, size_t n) override {
+        // Nur der Leser schreibt, darum gengt load/store
+        const int64_t bias = bias_.load(std::memory_order_relaxed);
+        const int64_t weight = static_cast<int64_t>(std::min(n, static_cast<size_t>(WINDOW)));
+        bias_.store(bias + ((up ? ONE : 0) - bias) * weight / WINDOW, std::memory_order_relaxed);
+        consumed_[up].store(consumed_[up].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    virtual void onFill(bool up, size_t n, std::chrono::nanoseconds duration) override {
+        (void)n;
+        const auto now = std::chrono::steady_clock::now();
+        const size_t consumed = consumed_[up].load(std::memory_order_relaxed);
+        if (lastFill_[up] != std::chrono::steady_clock::time_point{}) {
+            const double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastFill_[up]).count());
+            const double rate = elapsed > 0 ? (consumed - consumedAtLastFill_[up]) / elapsed : 0.0;  // Elemente pro ns
+            const size_t needed = static_cast<size_t>(rate * static_cast<double>(duration.count()) * safetyFactor_);
+            // Langsam abklingen lassen, damit ein einzelner schneller Fill die Schwelle nicht gleich wieder senkt
+            const size_t previous = neededAhead_[up].load(std::memory_order_relaxed);
+            neededAhead_[up].store(std::max(needed, previous - previous / 4), std::memory_order_relaxed);
+        }
+        lastFill_[up] = now;
+        consumedAtLastFill_[up] = consumed;
+    }
+
+    /** @return Richtungs-Tendenz zwischen 0 (nur abwrts) und 1 (nur aufwrts) */
+    double directionBias() const {
+        return static_cast<double>(bias_.load(std::memory_order_relaxed)) / ONE;
+    }
+
+private:
+
+    /** Festkomma-Darstellung von 1 fr bias_ */
+    static constexpr int64_t ONE{ 1 << 20 };
+    /** Anzahl Elemente, ber die bias_ etwa mittelt */
+    static constexpr int64_t WINDOW{ 256 };
+
+    /** Anteil des Caches (in ONE), der in Richtung up vor dem Lesezeiger liegen soll: 1/4 .. 3/4 */
+    size_t share(bool up) const {
+        const int64_t bias = bias_.load(std::memory_order_relaxed);
+        const int64_t upShare = ONE / 4 + bias / 2;
+        return static_cast<size_t>(up ? upShare : ONE - upShare);
+    }
+
+    const unsigned int safetyFactor_;
+    /** Richtungs-Tendenz in ONE. Wird nur vom Leser geschrieben. */
+    std::atomic<int64_t> bias_{ ONE / 2 };
+    /** Gelesene Elemente pro Richtung ([0]: abwrts). Wird nur vom Leser geschrieben. */
+    std::atomic<size_t> consumed_[2]{ {0}, {0} };
+    /** Aus dem Tempo geforderte Schwelle pro Richtung. Wird nur vom Fller geschrieben. */
+    std::atomic<size_t> neededAhead_[2]{ {0}, {0} };
+    /** Nur fr den Fller */
+    std::chrono::steady_clock::time_point lastFill_[2];
+    size_t consumedAtLastFill_[2]{0, 0};
+};
+
+#endif
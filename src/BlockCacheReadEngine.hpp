@@ -0,0 +1,187 @@
+
+#ifndef BLOCKCACHEREADENGINE_HPP_
+#define BLOCKCACHEREADENGINE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * IReadEngine vor einer anderen Engine, die die zuletzt gelesenen Blcke der Datei im Speicher behlt (LRU).
+ *
+ * Ein Leser, der um eine Viertel-Grenze pendelt, lsst den Buffer abwechselnd fillDownwards und fillUpwards aufrufen;
+ * jedes Mal wird das Viertel neu gelesen, das eben im Cache berschrieben wurde. ber diese Engine kommt es dann mit
+ * einem memcpy aus dem Block-Cache statt von der Platte.
+ *
+ * Die Blcke liegen auf Vielfachen von blockBytes in der Datei. Ein fehlender Block wird ganz gelesen, auch wenn nur ein
+ * Teil gebraucht wird. blockBytes = ein Viertel des Caches in Bytes passt zu den Fills der festen Viertel-Regel.
+ * Auch die Blcke, die noch im Cache des Buffers liegen, belegen Pltze: fr K verdrngte Viertel sind es K + 5 Blcke
+ * (vier Viertel im Cache, einer fr nicht ausgerichtete Fills nach seek).
+ *
+ * Wie die anderen Engines nur aus einem Thread gleichzeitig verwenden (der Buffer liest unter mutex_). #stats darf aus
+ * jedem Thread abgefragt werden.
+ *
+ *     PreadReadEngine disk{fd};
+ *     BlockCacheReadEngine engine{disk, 1024 / 4 * sizeof(myDataType), 16};
+ *     myBufferType buffer{engine};
+ */
+class BlockCacheReadEngine : public IReadEngine {
+public:
+
+    struct Stats_t {
+        /** Blcke, die aus dem Block-Cache kamen */
+        uint64_t hits;
+        /** Blcke, die von der darunterliegenden Engine gelesen wurden */
+        uint64_t misses;
+        /** Aus dem Block-Cache kopierte Bytes */
+        uint64_t bytesFromCache;
+    };
+
+    /**
+     * @param engine Darunterliegende Engine. Muss lnger leben als diese.
+     * @param blockBytes Grsse eines Blocks. Muss ein Vielfaches der Elementgrsse sein.
+     * @param nBlocks Anzahl Blcke im Block-Cache, mindestens 1. Der Speicher dafr wird im Konstruktor geholt.
+     */
+    BlockCacheReadEngine(IReadEngine &engine, size_t blockBytes, size_t nBlocks) :
+        engine_(engine), blockBytes_(blockBytes), memory_(blockBytes * nBlocks), slots_(nBlocks) {
+        assert(blockBytes > 0 && nBlocks > 0);
+        for (size_t i = 0; i < nBlocks; i++) {
+            slots_[i].data = memory_.data() + i * blockBytes;
+            lru_.push_back(i);
+            slots_[i].position = std::prev(lru_.end());
+        }
+        index_.reserve(nBlocks);
+    }
+
+    BlockCacheReadEngine(const BlockCacheReadEngine &) = delete;
+    BlockCacheReadEngine &operator=(const BlockCacheReadEngine &) = delete;
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        assert(blockBytes_ % elementSize == 0);
+        const uint64_t offset = static_cast<uint64_t>(first) * elementSize;
+        const size_t length = count * elementSize;
+        size_t done = 0;
+        while (done < length) {
+            const uint64_t block = (offset + done) / blockBytes_;
+            const size_t inBlock = static_cast<size_t>(offset + done - block * blockBytes_);
+            const size_t wanted = std::min(length - done, blockBytes_ - inBlock);
+            Slot_t *slot = find(block);
+            // Ein kurzer Block lag beim Lesen am Dateiende. Reicht er nicht, neu lesen: die Datei kann gewachsen sein.
+            if (slot != nullptr && slot->length >= inBlock + wanted) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                bytesFromCache_.fetch_add(wanted, std::memory_order_relaxed);
+            } else {
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                slot = load(block, elementSize, slot);
+            }
+            const size_t n = slot->length > inBlock ? std::min(wanted, slot->length - inBlock) : 0;
+            memcpy(static_cast<char *>(dest) + done, slot->data + inBlock, n);
+            done += n;
+            if (n < wanted) {
+                break;  // Dateiende
+            }
+        }
+        return done / elementSize;
+    }
+
+    /** Nur die Blcke, die nicht schon im Block-Cache liegen, auf ganze Blcke ausgedehnt an die Engine weitergeben */
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        const size_t elementsPerBlock = blockBytes_ / elementSize;
+        uint64_t block = first / elementsPerBlock;
+        const uint64_t end = (static_cast<uint64_t>(first) + count + elementsPerBlock - 1) / elementsPerBlock;
+        while (block < end && isCached(block)) {
+            block++;
+        }
+        uint64_t last = end;
+        while (last > block && isCached(last - 1)) {
+            last--;
+        }
+        if (block < last) {
+            engine_.prefetch(elementSize, static_cast<size_t>((last - block) * elementsPerBlock), static_cast<size_t>(block * elementsPerBlock));
+        }
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        return engine_.size(elementSize);
+    }
+
+    Stats_t stats() const {
+        Stats_t stats;
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        stats.misses = misses_.load(std::memory_order_relaxed);
+        stats.bytesFromCache = bytesFromCache_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+
+    struct Slot_t {
+        char *data{nullptr};
+        /** Gltige Bytes. Weniger als blockBytes_ nur am Dateiende. */
+        size_t length{0};
+        /** Block-Index in der Datei. Gltig, wenn used */
+        uint64_t block{0};
+        bool used{false};
+        /** Eintrag in lru_ */
+        std::list<size_t>::iterator position;
+    };
+
+    /** @return Der Block oder nullptr. Ein gefundener Block wird der zuletzt verwendete. */
+    Slot_t *find(uint64_t block) {
+        const auto found = index_.find(block);
+        if (found == index_.end()) {
+            return nullptr;
+        }
+        Slot_t &slot = slots_[found->second];
+        lru_.splice(lru_.end(), lru_, slot.position);
+        return &slot;
+    }
+
+    bool isCached(uint64_t block) const {
+        const auto found = index_.find(block);
+        return found != index_.end() && slots_[found->second].length == blockBytes_;
+    }
+
+    /**
+     * Liest den Block von der Engine. In slot, wenn er schon (zu kurz) im Block-Cache liegt, sonst im am lngsten nicht
+     * verwendeten Platz.
+     */
+    Slot_t *load(uint64_t block, size_t elementSize, Slot_t *slot) {
+        if (slot == nullptr) {
+            const size_t victim = lru_.front();
+            slot = &slots_[victim];
+            if (slot->used) {
+                index_.erase(slot->block);
+            }
+            slot->used = true;
+            slot->block = block;
+            index_[block] = victim;
+            lru_.splice(lru_.end(), lru_, slot->position);
+        }
+        const size_t elementsPerBlock = blockBytes_ / elementSize;
+        slot->length = engine_.read(slot->data, elementSize, elementsPerBlock, static_cast<size_t>(block * elementsPerBlock)) * elementSize;
+        return slot;
+    }
+
+    IReadEngine &engine_;
+    const size_t blockBytes_;
+    std::vector<char> memory_;
+    std::vector<Slot_t> slots_;
+    /** Indizes in slots_, vorne der am lngsten nicht verwendete */
+    std::list<size_t> lru_;
+    /** Block-Index in der Datei -> Index in slots_ */
+    std::unordered_map<uint64_t, size_t> index_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> bytesFromCache_{0};
+};
+
+#endif
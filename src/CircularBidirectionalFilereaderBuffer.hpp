@@ -3,20 +3,399 @@
 #define CIRCULARBIDIRECTIONALFILEREADERBUFFER_HPP_
 
 #include <stdio.h> // FILE
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <limits>
 #include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <cassert>
+#include <cstdint>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "SpanKernels.hpp"
 
 namespace UnitTest1 {
 	class UnitTest;
 }
 
+/**
+ * 1: Der Buffer fhrt Statistik ber Lesezustnde, Fills, gelesene Bytes, Lock-Haltezeiten usw., @see
+ * CircularBidirectionalFilereaderBuffer#stats. 0 (Standard): keine Statistik, der Code dafr wird nicht mitkompiliert.
+ * Vor dem ersten #include setzen, in allen bersetzungseinheiten gleich.
+ */
+#ifndef CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS
+#define CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS 0
+#endif
+
+/**
+ * Histogramm von Dauern in Zweierpotenz-Klassen: buckets[i] zhlt die Dauern von 2^i bis 2^(i+1) - 1 ns, buckets[0]
+ * auch 0 ns, die letzte Klasse alles darber.
+ */
+struct LatencyHistogram_t {
+    static constexpr size_t N_BUCKETS{ 40 };  // bis etwa 18 Minuten
+    uint64_t buckets[N_BUCKETS]{};
+
+    static size_t bucketOf(uint64_t ns) {
+        size_t bucket = 0;
+        while (ns > 1 && bucket < N_BUCKETS - 1) {
+            ns >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    /** @return Anzahl Eintrge */
+    uint64_t count() const {
+        uint64_t n = 0;
+        for (uint64_t bucketCount : buckets) {
+            n += bucketCount;
+        }
+        return n;
+    }
+
+    /** @return Obere Grenze in ns der Klasse, in der das Perzentil p (0 .. 1) liegt. 0, wenn leer. */
+    uint64_t percentileNs(double p) const {
+        const uint64_t n = count();
+        if (n == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(n) + 0.5));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < N_BUCKETS; bucket++) {
+            seen += buckets[bucket];
+            if (seen >= rank) {
+                return (uint64_t{ 2 } << bucket) - 1;
+            }
+        }
+        return (uint64_t{ 2 } << (N_BUCKETS - 1)) - 1;
+    }
+};
+
+/**
+ * Schnittstelle zum Lesen von Elementen aus der Datei. Die Fills des Buffers lesen immer ber eine solche Engine.
+ * Adressiert wird mit dem Element-Index in der Datei, nicht ber einen gemeinsamen Dateizeiger.
+ * @see StdioReadEngine, PreadReadEngine, IoUringReadEngine
+ */
+class IReadEngine {
+public:
+
+    virtual ~IReadEngine() {}
+
+    /**
+     * Liest Elemente.
+     * @param dest Ziel fr count Elemente
+     * @param elementSize Grsse eines Elements in Bytes
+     * @param count Anzahl zu lesende Elemente
+     * @param first Element-Index in der Datei des ersten zu lesenden Elements
+     * @return Anzahl gelesene Elemente. Weniger als count nur am Dateiende.
+     */
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) = 0;
+
+    /**
+     * Hinweis, dass als nchstes [first, first + count) gelesen wird. Engines mit asynchronem I/O starten damit das Lesen,
+     * so dass es sich mit dem Konsumieren berlappt. Standardmssig ohne Wirkung.
+     */
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) {
+        (void)elementSize;
+        (void)count;
+        (void)first;
+    }
+
+    /**
+     * @return Anzahl ganzer Elemente in der Datei. std::numeric_limits<size_t>::max(), wenn unbekannt (Standard).
+     *         Wird nur beim Neuaufbau in CircularBidirectionalFilereaderBuffer#seek gebraucht.
+     */
+    virtual size_t size(size_t elementSize) {
+        (void)elementSize;
+        return std::numeric_limits<size_t>::max();
+    }
+};
+
+/**
+ * IReadEngine mit fseek und fread auf einem FILE*. Alle Zugriffe gehen ber den einen Dateizeiger des Streams;
+ * darum nur aus einem Thread verwenden.
+ * Positioniert mit 64-Bit-Offsets (_fseeki64 unter Windows, sonst fseeko), Dateien ber 2 GiB gehen also auch dort,
+ * wo long 32 Bit hat. Auf 32-Bit-Linux dafr mit _FILE_OFFSET_BITS=64 bersetzen.
+ */
+class StdioReadEngine : public IReadEngine {
+public:
+
+    /** @param file zum Lesen geffnete Datei */
+    StdioReadEngine(FILE *file) : file_(file) {}
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        const int64_t offset = static_cast<int64_t>(first) * static_cast<int64_t>(elementSize);
+        // fseek verwirft den Puffer des Streams, darum nur wenn ntig. Nach dem Dateiende auch, um das EOF-Flag
+        // zurckzusetzen: die Datei kann gewachsen sein (Folgemodus).
+        if (offset != filePointer_ || feof(file_)) {
+            if (seek(offset, SEEK_SET) != 0) {
+                filePointer_ = -1;
+                return 0;
+            }
+        }
+        const size_t nRead = fread(dest, elementSize, count, file_);
+        filePointer_ = offset + static_cast<int64_t>(nRead * elementSize);
+        return nRead;
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        filePointer_ = -1;
+        if (seek(0, SEEK_END) != 0) {
+            return std::numeric_limits<size_t>::max();
+        }
+#if defined(_WIN32)
+        const int64_t end = _ftelli64(file_);
+#else
+        const int64_t end = ftello(file_);
+#endif
+        return end < 0 ? std::numeric_limits<size_t>::max() : static_cast<size_t>(static_cast<uint64_t>(end) / elementSize);
+    }
+
+private:
+
+    /** fseek mit 64-Bit-Offset */
+    int seek(int64_t offset, int origin) {
+#if defined(_WIN32)
+        return _fseeki64(file_, offset, origin);
+#else
+        return fseeko(file_, static_cast<off_t>(offset), origin);
+#endif
+    }
+
+    FILE *file_;
+    /** Merkt sich, wo der Lese-Pointer der geffneten Datei steht (in Bytes). Eigentlich das, was ftell zurckgeben wrde. -1: unbekannt */
+    int64_t filePointer_{-1};
+};
+
+/**
+ * Vom IRingAllocator gelieferter Speicher fr den Cache.
+ */
+struct RingMemory_t {
+    void *data{nullptr};
+    /** Tatschlich belegte Bytes (mit Aufrundung auf ganze Seiten bzw. Huge Pages) */
+    size_t allocatedBytes{0};
+    /** Auf Huge Pages (MAP_HUGETLB) oder fr Transparent Huge Pages markiert */
+    bool hugePages{false};
+    /** Mit mmap statt operator new belegt. Nur fr den Allocator selbst. */
+    bool mapped{false};
+};
+
+/**
+ * Liefert den Speicher fr einen Cache, dessen Lnge erst zur Laufzeit feststeht.
+ * @see DefaultRingAllocator, CircularBidirectionalFilereaderBuffer mit DATA_TUPLES_CHACHE_LENGTH = 0
+ */
+class IRingAllocator {
+public:
+
+    virtual ~IRingAllocator() {}
+
+    /** @return Speicher fr mindestens bytes Bytes, auf mindestens eine Cache-Line ausgerichtet. data == nullptr bei Fehler. */
+    virtual RingMemory_t allocate(size_t bytes) = 0;
+
+    virtual void deallocate(const RingMemory_t &memory) = 0;
+};
+
+/**
+ * Standard-IRingAllocator. Ab 2 MiB unter Linux auf 2 MiB ausgerichtet und auf Huge Pages, damit das Durchlaufen grosser
+ * Caches weniger TLB-Misses hat: zuerst MAP_HUGETLB (reservierte Huge Pages), sonst ein ausgerichtetes Mapping mit
+ * MADV_HUGEPAGE (Transparent Huge Pages). Darunter bzw. auf anderen Systemen operator new mit Cache-Line-Ausrichtung.
+ */
+class DefaultRingAllocator : public IRingAllocator {
+public:
+
+    static constexpr size_t HUGE_PAGE_SIZE{ 2u << 20 };
+    static constexpr size_t CACHE_LINE_SIZE{ 64u };
+
+    virtual RingMemory_t allocate(size_t bytes) override {
+        RingMemory_t memory;
+#if defined(__linux__)
+        if (bytes >= HUGE_PAGE_SIZE) {
+            const size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            void *p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                memory.data = p;
+                memory.allocatedBytes = rounded;
+                memory.hugePages = true;
+                memory.mapped = true;
+                return memory;
+            }
+            // Keine Huge Pages reserviert: eine Huge Page mehr mappen und den ausgerichteten Teil behalten
+            p = mmap(nullptr, rounded + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED) {
+                char *begin = static_cast<char *>(p);
+                char *aligned = begin + (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(begin) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+                if (aligned > begin) {
+                    munmap(begin, static_cast<size_t>(aligned - begin));
+                }
+                char *end = begin + rounded + HUGE_PAGE_SIZE;
+                if (end > aligned + rounded) {
+                    munmap(aligned + rounded, static_cast<size_t>(end - (aligned + rounded)));
+                }
+                memory.data = aligned;
+                memory.allocatedBytes = rounded;
+#ifdef MADV_HUGEPAGE
+                memory.hugePages = madvise(aligned, rounded, MADV_HUGEPAGE) == 0;
+#endif
+                memory.mapped = true;
+                return memory;
+            }
+        }
+#endif
+        memory.data = ::operator new(bytes, std::align_val_t{CACHE_LINE_SIZE}, std::nothrow);
+        memory.allocatedBytes = memory.data != nullptr ? bytes : 0;
+        return memory;
+    }
+
+    virtual void deallocate(const RingMemory_t &memory) override {
+#if defined(__linux__)
+        if (memory.mapped) {
+            munmap(memory.data, memory.allocatedBytes);
+            return;
+        }
+#endif
+        ::operator delete(memory.data, std::align_val_t{CACHE_LINE_SIZE});
+    }
+};
+
+/**
+ * Bestimmt, wann und um wie viel ein Buffer nachfllt. Die Standard-Implementierung ist die feste Viertel-Regel, wie sie
+ * der Buffer ohne Policy verwendet: Fill anfordern, wenn in Leserichtung noch ein Viertel im Cache liegt, dann um ein
+ * Viertel verschieben; #initialize und #seek laden eine halbe Cache-Lnge ab der Position.
+ * Leser und Fller rufen gleichzeitig auf, Implementierungen mssen das aushalten (z.B. mit relaxed Atomics).
+ * Der Buffer begrenzt die Werte so, dass der Leser nie berschrieben wird, @see CircularBidirectionalFilereaderBuffer#setPrefetchPolicy
+ * @see AdaptivePrefetchPolicy
+ */
+class IPrefetchPolicy {
+public:
+
+    virtual ~IPrefetchPolicy() {}
+
+    /**
+     * @return Fill in Richtung up anfordern, wenn dort nur noch so viele Elemente im Cache liegen (inkl. aktuellem).
+     * @param capacity Lnge des Caches in Elementen
+     */
+    virtual size_t fillThreshold(bool up, size_t capacity) const {
+        (void)up;
+        return capacity / 4;
+    }
+
+    /** @return Anzahl Elemente, um die ein Fill in Richtung up den Cache verschiebt. */
+    virtual size_t fillSize(bool up, size_t capacity) const {
+        (void)up;
+        return capacity / 4;
+    }
+
+    /** @return Anzahl Elemente, die #initialize und #seek ab der Position aufwrts laden. Der Rest des Caches liegt darunter. */
+    virtual size_t lookahead(size_t capacity) const {
+        return capacity / 2;
+    }
+
+    /** Vom Leser: n Elemente in Richtung up gelesen. */
+    virtual void onRead(bool up, size_t n) {
+        (void)up;
+        (void)n;
+    }
+
+    /** Vom Fller: Fill in Richtung up mit n Elementen fertig, hat duration gedauert. */
+    virtual void onFill(bool up, size_t n, std::chrono::nanoseconds duration) {
+        (void)up;
+        (void)n;
+        (void)duration;
+    }
+};
+
+/**
+ * Worker-Thread, der auf requestFill hin fillUpwards bzw. fillDownwards des Buffers aufruft.
+ * Grundlage fr die DefaultListener der Buffer-Klassen.
+ * @tparam BUFFER Buffer mit setListener, fillUpwards und fillDownwards
+ * @tparam LISTENER_INTERFACE IBackgroundTaskListener des Buffers
+ */
+template <class BUFFER, class LISTENER_INTERFACE>
+class BackgroundFillThread : public LISTENER_INTERFACE {
+public:
+
+    BackgroundFillThread(BUFFER &theBuffer) : theBuffer_(theBuffer) {
+        theBuffer_.setListener(this);
+    }
+
+    virtual ~BackgroundFillThread() {
+        assert(!thread_.joinable());  // vorher tearDown aufrufen
+    }
+
+    virtual void requestFill(bool up) override {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (up) {
+                fillUpRequested_ = true;
+            } else {
+                fillDownRequested_ = true;
+            }
+        }
+        cv.notify_one();
+    }
+
+    void tearDown() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            keepRunning = false;
+        }
+        cv.notify_one();
+        thread_.join();
+    }
+
+private:
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true) {
+            // Anforderungen werden im Flag gemerkt. So geht keine verloren, die kommt, whrend gerade gefllt wird.
+            cv.wait(lock, [this] { return !keepRunning || fillUpRequested_ || fillDownRequested_; });
+            if (!keepRunning) {
+                break;
+            }
+            const bool up = fillUpRequested_;
+            const bool down = fillDownRequested_;
+            fillUpRequested_ = false;
+            fillDownRequested_ = false;
+            lock.unlock();
+            if (up) {
+                theBuffer_.fillUpwards();
+            }
+            if (down) {
+                theBuffer_.fillDownwards();
+            }
+            lock.lock();
+        }
+    }
+
+    BUFFER &theBuffer_;
+    std::mutex mutex_;  // eigener Mutex, damit der des Buffers nicht rekursiv sein muss.
+    std::condition_variable cv;
+    bool keepRunning{true};
+    bool fillUpRequested_{false};
+    bool fillDownRequested_{false};
+    std::thread thread_{&BackgroundFillThread::run, this};  // zuletzt, damit run() nur initialisierte Member sieht
+
+};
+
 /**
  * Cache fr das Lesen aus einer Datei
  * @tparam T Typ der Datenelemente. Lnge in Bytes muss eine Zweierpotenz sein (1, 2, 4, ....)
- * @tparam DATA_TUPLES_CHACHE_LENGTH Anzahl Elemente von T. Muss eine Zweierpotenz sein
+ * @tparam DATA_TUPLES_CHACHE_LENGTH Anzahl Elemente von T. Muss eine Zweierpotenz sein. 0: Lnge erst im Konstruktor, der
+ *         Cache liegt dann nicht im Objekt, sondern kommt von einem IRingAllocator, @see DynamicFilereaderBuffer
+ * @tparam LOCK_FREE true: Leser (getNext, getPrev, ...) und Fller (fillUpwards, fillDownwards) tauschen die Indizes
+ *         base_, top_, bottom_ und topOfFile_ ber Atomics aus. Dann darf es nur genau einen Leser-Thread und genau einen
+ *         Fller-Thread geben. Der Leser wartet so nie auf ein laufendes fread. mutex_ schtzt dann nur noch die Fills
+ *         gegen #initialize und den Neuaufbau in #seek.
  */
-template <class T, unsigned int DATA_TUPLES_CHACHE_LENGTH>
+template <class T, unsigned int DATA_TUPLES_CHACHE_LENGTH, bool LOCK_FREE = false>
 class CircularBidirectionalFilereaderBuffer {
 
     public:
@@ -35,6 +414,25 @@ class CircularBidirectionalFilereaderBuffer {
             CACHE_OVERFLOW
         };
 
+        /**
+         * Nur lesbarer Ausschnitt aus dem Cache, wie er von #getNextSpan und #getPrevSpan zurckgegeben wird.
+         * Die Elemente liegen in Datei-Reihenfolge (aufsteigend) in hchstens zwei zusammenhngenden Stcken:
+         * zuerst [first, first + firstLength), dann [second, second + secondLength). Das zweite Stck ist nur
+         * belegt, wenn der Ausschnitt ber das Ende von data_ hinausluft.
+         * Gltig bis zum nchsten Aufruf von getNext..., getPrev... oder #initialize.
+         */
+        struct Span_t {
+            const T *first{nullptr};
+            size_t firstLength{0};
+            const T *second{nullptr};
+            size_t secondLength{0};
+
+            /** Anzahl Elemente in beiden Stcken zusammen */
+            size_t size() const {
+                return firstLength + secondLength;
+            }
+        };
+
         /**
          * Interface zur Benachrichtigung, dass der Cache aufgefllt werden soll. Also, das aus einem
          * Worker-Task CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH>#fillUpwards oder CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH>#fillDownwards aufgerufen werden soll, um neue Werte bereit zu machen.
@@ -54,51 +452,12 @@ class CircularBidirectionalFilereaderBuffer {
         /**
          * Diese Implementierung von IBackgroundTaskListener kann standardmssig verwendet werden.
          */
-        class DefaultListener : public CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH>::IBackgroundTaskListener {
+        class DefaultListener : public BackgroundFillThread<CircularBidirectionalFilereaderBuffer, IBackgroundTaskListener> {
         public:
 
-            DefaultListener(CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH> &theBuffer) : theBuffer_(theBuffer) {
-                theBuffer_.setListener(this);
-            }
-
-            virtual ~DefaultListener() {
-                assert(!thread_.joinable());  // vorher tearDown aufrufen
-            }
-
-            virtual void requestFill(bool up) override {
-                fillRequestDirectionUp_ = up;
-                cv.notify_one();
-            }
-
-            void tearDown() {
-                keepRunning = false;
-                cv.notify_one();
-                thread_.join();
+            DefaultListener(CircularBidirectionalFilereaderBuffer &theBuffer) :
+                BackgroundFillThread<CircularBidirectionalFilereaderBuffer, IBackgroundTaskListener>(theBuffer) {
             }
-
-        private:
-
-            void run() {
-                while (keepRunning) {
-                    std::mutex mutex;  // eigenen Mutex, damit der des Buffers nicht rekursiv sein muss.
-                    {
-                        std::unique_lock<std::mutex> lock{mutex};
-                        cv.wait(lock);
-                        if (fillRequestDirectionUp_) {
-                            theBuffer_.fillUpwards();
-                        } else {
-                            theBuffer_.fillDownwards();
-                        }
-                    }
-                }
-            }
-
-            CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH> &theBuffer_;
-            std::thread thread_{&DefaultListener::run, this};
-            std::condition_variable cv;
-            bool keepRunning{true};
-            bool fillRequestDirectionUp_{false};
-
         };
 
         /**
@@ -106,12 +465,128 @@ class CircularBidirectionalFilereaderBuffer {
          * @param listener wird benachrichtigt, wenn der Cache aufgefllt werden muss
          */
         CircularBidirectionalFilereaderBuffer(FILE* file) :
-            file_(file) {
+            data_(inlineData_), stdioEngine_(file), engine_(&stdioEngine_) {
             static_assert(DATA_TUPLES_CHACHE_LENGTH && !(DATA_TUPLES_CHACHE_LENGTH & (DATA_TUPLES_CHACHE_LENGTH - 1)));  // Power of two
 			static_assert(sizeof(T) && !(sizeof(T) & (sizeof(T) - 1)));
             initialize();
         }
 
+        /**
+         * @param engine liest die Elemente aus der Datei, @see IReadEngine. Muss lnger leben als der Buffer.
+         */
+        CircularBidirectionalFilereaderBuffer(IReadEngine &engine) :
+            data_(inlineData_), stdioEngine_(nullptr), engine_(&engine) {
+            static_assert(DATA_TUPLES_CHACHE_LENGTH && !(DATA_TUPLES_CHACHE_LENGTH & (DATA_TUPLES_CHACHE_LENGTH - 1)));  // Power of two
+			static_assert(sizeof(T) && !(sizeof(T) & (sizeof(T) - 1)));
+            initialize();
+        }
+
+        /**
+         * Fr DATA_TUPLES_CHACHE_LENGTH = 0: Lnge des Caches zur Laufzeit.
+         * @param file zum Lesen geffnete Datei
+         * @param capacity Lnge des Caches in Elementen. Muss eine Zweierpotenz sein, mindestens 4
+         * @param allocator liefert den Speicher fr den Cache. nullptr: DefaultRingAllocator. Muss lnger leben als der Buffer.
+         * @throws std::bad_alloc wenn der allocator keinen Speicher liefert
+         */
+        CircularBidirectionalFilereaderBuffer(FILE* file, size_t capacity, IRingAllocator *allocator = nullptr) :
+            stdioEngine_(file), engine_(&stdioEngine_) {
+            allocateRing(capacity, allocator);
+            initialize();
+        }
+
+        /**
+         * Fr DATA_TUPLES_CHACHE_LENGTH = 0, @see CircularBidirectionalFilereaderBuffer(FILE*, size_t, IRingAllocator*)
+         * @param engine liest die Elemente aus der Datei, @see IReadEngine. Muss lnger leben als der Buffer.
+         */
+        CircularBidirectionalFilereaderBuffer(IReadEngine &engine, size_t capacity, IRingAllocator *allocator = nullptr) :
+            stdioEngine_(nullptr), engine_(&engine) {
+            allocateRing(capacity, allocator);
+            initialize();
+        }
+
+        ~CircularBidirectionalFilereaderBuffer() {
+            if (allocator_ != nullptr) {
+                allocator_->deallocate(memory_);
+            }
+        }
+
+        /**
+         * Speicherbedarf des Caches und, mit CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS, Betriebsstatistik seit dem
+         * Konstruktor. Ohne Statistik sind die Zhler 0 und die Histogramme leer.
+         */
+        struct Stats_t {
+            /** Lnge des Caches in Elementen */
+            size_t capacity;
+            /** Bytes fr die Elemente im Cache */
+            size_t ringBytes;
+            /** Tatschlich belegte Bytes fr den Cache. Bei fester Lnge im Objekt, gleich ringBytes. */
+            size_t allocatedBytes;
+            /** Der Cache liegt auf Huge Pages, @see DefaultRingAllocator */
+            bool hugePages;
+            /** Ergebnisse von getNext, getPrev, getNextSpan und getPrevSpan, Index ist der CacheState_t */
+            uint64_t states[4]{};
+            /** Fills mit neuen Daten. [0]: abwrts, [1]: aufwrts */
+            uint64_t fills[2]{};
+            /** Fill-Aufrufe, die nichts gelesen haben: doppelt angefordert, am Dateiende oder im LOCK_FREE-Betrieb abgebrochen */
+            uint64_t rejectedFills[2]{};
+            /** Aus der Datei gelesene Bytes (Fills, initialize, Neuaufbau) */
+            uint64_t bytesRead{0};
+            /**
+             * Lesezugriffe auf die Engine, die nicht dort weiterlesen, wo der vorherige aufgehrt hat: Die Datei muss neu
+             * positioniert werden (fseek bei StdioReadEngine). Fills abwrts und nach einem Richtungswechsel, Neuaufbau
+             * und Proben von seekToKey; aufeinander folgende Fills aufwrts lesen einfach weiter.
+             */
+            uint64_t seeks{0};
+            /** Aufrufe von seek und seekToKey */
+            uint64_t seekCalls{0};
+            /** Davon mit Neuaufbau des Caches */
+            uint64_t rebuilds{0};
+            /** Dauer der Fills mit neuen Daten */
+            LatencyHistogram_t fillLatency;
+            /** Haltezeiten von mutex_: Fills, initialize, Neuaufbau, im Betrieb mit Mutex auch die Lesezugriffe */
+            LatencyHistogram_t lockHold;
+            /**
+             * Tiefster fillLevelDown ([0]) bzw. fillLevelUp ([1]) nach einem Lesezugriff, ausser am Dateianfang bzw.
+             * -ende. SIZE_MAX, solange nicht gelesen wurde. Nahe bei 1 heisst: Cache zu klein oder Fller zu langsam.
+             */
+            size_t lowWater[2]{ std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max() };
+        };
+
+        /** Momentaufnahme, ohne Lock. Die Zhler sind einzeln aktuell, aber nicht untereinander abgeglichen. */
+        Stats_t stats() const {
+            Stats_t stats;
+            stats.capacity = capacity();
+            stats.ringBytes = capacity() * sizeof(T);
+            stats.allocatedBytes = allocator_ != nullptr ? memory_.allocatedBytes : stats.ringBytes;
+            stats.hugePages = memory_.hugePages;
+#if CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS
+            for (size_t i = 0; i < 4; i++) {
+                stats.states[i] = counters_.states[i].load(std::memory_order_relaxed);
+            }
+            for (size_t up = 0; up < 2; up++) {
+                stats.fills[up] = counters_.fills[up].load(std::memory_order_relaxed);
+                stats.rejectedFills[up] = counters_.rejectedFills[up].load(std::memory_order_relaxed);
+                stats.lowWater[up] = counters_.lowWater[up].load(std::memory_order_relaxed);
+            }
+            stats.bytesRead = counters_.bytesRead.load(std::memory_order_relaxed);
+            stats.seeks = counters_.seeks.load(std::memory_order_relaxed);
+            stats.seekCalls = counters_.seekCalls.load(std::memory_order_relaxed);
+            stats.rebuilds = counters_.rebuilds.load(std::memory_order_relaxed);
+            counters_.fillLatency.copyTo(stats.fillLatency);
+            counters_.lockHold.copyTo(stats.lockHold);
+#endif
+            return stats;
+        }
+
+        /** Lnge des Caches in Elementen */
+        size_t capacity() const {
+            if constexpr (DATA_TUPLES_CHACHE_LENGTH != 0) {
+                return DATA_TUPLES_CHACHE_LENGTH;
+            } else {
+                return capacity_;
+            }
+        }
+
         /**
         * Setzen des Listeners. Muss ausgefhrt werden bevor #getNext oder #getPrev aufgerufen werden.
         */
@@ -119,175 +594,1213 @@ class CircularBidirectionalFilereaderBuffer {
             listener_ = l;
         }
 
+        /**
+         * Setzen der Prefetch-Policy. nullptr (Standard): feste Viertel-Regel. Muss lnger leben als der Buffer.
+         * Vor dem ersten Lesen setzen, wirkt auf #initialize erst beim nchsten Aufruf.
+         * Die Werte der Policy werden begrenzt: Schwelle 1 .. 1/2, Fill-Grsse 1 .. 3/4 minus Schwelle, Lookahead 1/4 .. 3/4
+         * der Cache-Lnge. So bleibt zwischen Leser und Fill immer ein Viertel Abstand.
+         */
+        void setPrefetchPolicy(IPrefetchPolicy *policy) {
+            policy_ = policy;
+        }
+
+        /**
+         * Folgemodus fr Dateien, an die noch geschrieben wird. Das Dateiende gilt dann nur bis zum nchsten Fill: jeder
+         * fillUpwards liest ber das bekannte Ende hinaus und verschiebt es, wenn die Datei gewachsen ist. getNext liefert
+         * am Ende weiterhin END_OF_FILE (und fordert einen Fill an), das blockierende getNext(ele, timeout) wartet dort auf
+         * neue Elemente. Angestossen werden die Fills z.B. von einem FileFollower, @see notifyFileGrown.
+         * Ein unvollstndiges Element am Dateiende wird erst gelesen, wenn es ganz geschrieben ist.
+         */
+        void setFollow(bool follow) {
+            follow_.store(follow, std::memory_order_relaxed);
+        }
+
+        bool isFollowing() const {
+            return follow_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Meldet, dass die Datei gewachsen ist (aus einem beliebigen Thread). Im Folgemodus wird ein Fill aufwrts
+         * angefordert; ein am Dateiende wartender Leser bekommt danach die neuen Elemente.
+         * @pre #setListener ausgefhrt.
+         */
+        void notifyFileGrown() {
+            if (isFollowing()) {
+                listener_->requestFill(true);
+            }
+        }
+
+        /**
+         * Anzahl Elemente, die in Richtung up hinter der aktuellen Position noch im Cache liegen. Ohne Lock gelesen, also
+         * nur ein Richtwert; dient dem Priorisieren der Fills, @see FillScheduler.
+         * Wie fillLevelUp() - 1 bzw. fillLevelDown() - 1, aber ber die Position in der Datei gerechnet, damit ein voller
+         * Cache nicht als leer gilt.
+         */
+        size_t fillLevel(bool up) const {
+            const size_t bottom = bottom_.load(std::memory_order_relaxed);
+            const size_t top = top_.load(std::memory_order_relaxed);
+            const size_t position = absolutePosition(base_.load(std::memory_order_relaxed), bottom);
+            if (up) {
+                return top > position ? top - position - 1 : 0;
+            }
+            return position > bottom ? position - bottom : 0;
+        }
+
         /**
          * Setzt den Cache zurck. Lesezeiger am Anfang des Caches. Cache bis zur Hlfte gefllt mit Daten aus der Datei.
+         * Wartet auf einen laufenden Fill.
          */
         void initialize() {
-            filePointer_ = 0;
-            base_ = 0;
-            bottom_ = 0;
-            rewind(file_);
-            top_ = fread(data_, sizeof(T), DATA_TUPLES_CHACHE_LENGTH / 2, file_);
-            filePointer_ = top_;
+            auto lock = lockFill();
+            const size_t top = read_with_eof_check(data_, sizeof(T), lookahead(), 0);
+            base_.store(0, std::memory_order_relaxed);
+            bottom_.store(0, RELEASE);
+            top_.store(top, RELEASE);
         }
-        
+
+        /**
+         * Setzt den Lesezeiger auf das Element elementIndex der Datei.
+         * Liegt es im Cache, wird nur base_ verschoben. Sonst wird der Cache darum herum neu aufgebaut: eine halbe
+         * Cache-Lnge davor und eine danach, mit einem Lesevorgang (am Ende von data_ in zwei Stcke geteilt). Der
+         * Neuaufbau wartet auf einen laufenden Fill, auch im LOCK_FREE-Betrieb.
+         * @return OK, oder CACHE_OVERFLOW, wenn elementIndex hinter dem Dateiende liegt. Dann steht der Lesezeiger auf
+         *         dem letzten Element.
+         * @pre Datei nicht leer
+         */
+        CacheState_t seek(size_t elementIndex) {
+            noteSeek(false);
+            if (LOCK_FREE) {
+                // Wie bei getNext: zuerst ankndigen, dann prfen. @see retractBottom
+                base_.store(elementIndex & (capacity() - 1), HANDSHAKE);
+                if (elementIndex >= bottom_.load(HANDSHAKE) && elementIndex < top_.load(HANDSHAKE)) {
+                    return CacheState_t::OK;
+                }
+            }
+            auto lock = lockFill();
+            return seekLocked(elementIndex);
+        }
+
+        /**
+         * Setzt den Lesezeiger auf das erste Element, dessen Schlssel nicht kleiner als key ist, in einer nach dem
+         * Schlssel aufsteigend sortierten Datei (z.B. Records, die mit einem Zeitstempel beginnen). Gesucht wird
+         * zuerst im Cache, dann in der Datei: abwechselnd mit Interpolation (bei arithmetischem KEY) und Halbierung,
+         * mit einem gelesenen Element pro Schritt, also O(log n) Lesevorgngen statt eines Durchlaufs. Ist der
+         * verbleibende Bereich hchstens eine Viertel Cache-Lnge gross, wird der Cache darum herum neu aufgebaut wie
+         * bei #seek und darin fertig gesucht. getNext und getPrev finden die Nachbarn danach im Cache.
+         * Die Suche hlt den Fill-Lock, auch im LOCK_FREE-Betrieb.
+         * @param extractor liefert den Schlssel eines Elements, KEY extractor(const T &)
+         * @param first, last das gesuchte Element liegt sicher zwischen first und last (einschliesslich; last ist
+         *        auch "keines"), z.B. von einem KeyIndex. Standard: die ganze Datei.
+         * @return OK, oder CACHE_OVERFLOW, wenn alle Schlssel kleiner als key sind. Dann steht der Lesezeiger auf dem
+         *         letzten Element.
+         * @pre Datei nicht leer und nach extractor sortiert. Die Engine kennt ihre Grsse, oder last ist gesetzt.
+         */
+        template <class KEY, class EXTRACTOR>
+        CacheState_t seekToKey(const KEY &key, EXTRACTOR extractor, size_t first = 0, size_t last = std::numeric_limits<size_t>::max()) {
+            noteSeek(false);
+            auto lock = lockFill();
+            auto keyAt = [this, &extractor](size_t index) { return extractor(data_[index & (capacity() - 1)]); };
+            const size_t end = endOfFile();
+            // Gesucht ist das erste Element in [lo, hi) mit Schlssel >= key; gibt es keines, hi
+            size_t lo = std::min(first, end);
+            size_t hi = std::min(last, end);
+            // Schlssel der Elemente lo - 1 und hi, soweit bekannt. Fr die Interpolation.
+            typedef typename std::decay<decltype(extractor(std::declval<const T &>()))>::type Extracted_t;
+            Extracted_t keyBelow{};
+            Extracted_t keyAbove{};
+            bool knowBelow = false;
+            bool knowAbove = false;
+            bool interpolate = true;
+            bool rebuilt = false;
+            while (lo < hi) {
+                // Rnder des Caches: danach liegt [lo, hi) ganz im Cache oder ganz ausserhalb
+                const size_t bottom = bottom_.load(std::memory_order_relaxed);
+                const size_t top = top_.load(std::memory_order_relaxed);
+                if (top > bottom && top - 1 >= lo && top - 1 < hi) {
+                    const Extracted_t k = keyAt(top - 1);
+                    if (k < key) {
+                        lo = top;
+                        keyBelow = k;
+                        knowBelow = true;
+                    } else {
+                        hi = top - 1;
+                        keyAbove = k;
+                        knowAbove = true;
+                    }
+                }
+                if (top > bottom && bottom >= lo && bottom < hi) {
+                    const Extracted_t k = keyAt(bottom);
+                    if (k < key) {
+                        lo = bottom + 1;
+                        keyBelow = k;
+                        knowBelow = true;
+                    } else {
+                        hi = bottom;
+                        keyAbove = k;
+                        knowAbove = true;
+                    }
+                }
+                if (lo >= hi) {
+                    break;
+                }
+                if (lo >= bottom && hi <= top) {
+                    // Im Cache fertig suchen
+                    while (lo < hi) {
+                        const size_t middle = lo + (hi - lo) / 2;
+                        if (keyAt(middle) < key) {
+                            lo = middle + 1;
+                        } else {
+                            hi = middle;
+                        }
+                    }
+                    break;
+                }
+                if (hi - lo <= capacity() / 4 && !rebuilt) {
+                    // Ein Lesevorgang fr den Rest, den braucht der Cache an der neuen Position ohnehin
+                    recentre(lo + (hi - lo) / 2);
+                    noteSeek(true);
+                    rebuilt = true;
+                    continue;
+                }
+                size_t probe = lo + (hi - lo) / 2;
+                if constexpr (std::is_arithmetic<KEY>::value && std::is_arithmetic<Extracted_t>::value) {
+                    if (interpolate && knowBelow && knowAbove && keyBelow < keyAbove) {
+                        const double fraction = (static_cast<double>(key) - static_cast<double>(keyBelow)) / (static_cast<double>(keyAbove) - static_cast<double>(keyBelow));
+                        probe = lo + std::min(hi - lo - 1, static_cast<size_t>(std::max(0.0, fraction) * static_cast<double>(hi - lo)));
+                    }
+                }
+                interpolate = !interpolate;  // Abwechselnd halbieren: hchstens doppelt so viele Schritte wie binr
+                T element;
+                const size_t nProbed = engine_->read(&element, sizeof(T), 1, probe);
+                noteEngineRead(probe, nProbed);
+                if (nProbed != 1) {
+                    hi = probe;  // Datei krzer als angenommen
+                    knowAbove = false;
+                    continue;
+                }
+                noteBytesRead(sizeof(T));
+                const Extracted_t k = extractor(element);
+                if (k < key) {
+                    lo = probe + 1;
+                    keyBelow = k;
+                    knowBelow = true;
+                } else {
+                    hi = probe;
+                    keyAbove = k;
+                    knowAbove = true;
+                }
+            }
+            if (lo == end && end > 0) {
+                // Alle Schlssel kleiner: aufs letzte Element, ohne Neuaufbau, wenn es im Cache ist
+                seekLocked(end - 1);
+                return CacheState_t::CACHE_OVERFLOW;
+            }
+            return seekLocked(lo);
+        }
+
+        /**
+         * @return Element-Index in der Datei der aktuellen Position, also des Elements, das #getCurrent liefert.
+         */
+        size_t position() const {
+            auto lock = lockState();
+            const size_t base = base_.load(std::memory_order_relaxed);
+            while (true) {
+                const size_t position = absolutePosition(base, bottom_.load(ACQUIRE));
+                // Im LOCK_FREE-Betrieb kann bottom_ bzw. top_ kurz zurckgenommen sein, @see retractBottom. Dann nochmals.
+                if (!LOCK_FREE || position < top_.load(ACQUIRE)) {
+                    return position;
+                }
+                std::this_thread::yield();
+            }
+        }
+
         /**
          * Rckgabe des Elements an der aktuellen Position
          */
         void getCurrent(T& ele) const {
-            ele = data_[base_];
+            ele = data_[base_.load(std::memory_order_relaxed)];
         }
 
         /**
         * Rckgabe des nchsten Werts
         * @param[out] ele Der Wert
-        * @return @see CacheState_t
+        * @return @see CacheState_t. Im LOCK_FREE-Betrieb wird bei CACHE_OVERFLOW die Position nicht verndert und ele
+        *         nicht gesetzt, weil der Bereich dahinter gerade gefllt werden knnte.
         * @pre #setListener ausgefhrt.
         */
         CacheState_t getNext(T& ele) {
             CacheState_t retVal{ CacheState_t::OK };
             bool requestFill{false};
             {
-                std::lock_guard<std::mutex> lock{mutex_};
-                base_ = (base_ + 1) % DATA_TUPLES_CHACHE_LENGTH;
-                if (top_ == topOfFile_ && base_ == DATA_TUPLES_CHACHE_LENGTH - 1) {
-                    retVal = CacheState_t::END_OF_FILE;
-                } else if (top_ > topOfFile_) {
-                    retVal = CacheState_t::CACHE_OVERFLOW;
-                } else if (fillLevelUp() <= 1) {  // FillLevel erneut abfragen; knnte schon gendert haben (wenn requestFill den fill im gleichen Kontext aufruft.
-                    retVal = CacheState_t::ALMOST_EMPTY;
+                auto lock = lockState();
+                const size_t oldBase = base_.load(std::memory_order_relaxed);
+                const size_t base = (oldBase + 1) & (capacity() - 1);
+                base_.store(base, HANDSHAKE);  // zuerst ankndigen, dann prfen. @see retractBottom
+                const size_t bottom = bottom_.load(HANDSHAKE);
+                const size_t top = top_.load(HANDSHAKE);
+                const size_t topOfFile = topOfFile_.load(ACQUIRE);
+                if (absolutePosition(oldBase, bottom) + 1 >= top && (LOCK_FREE || top == topOfFile)) {
+                    base_.store(oldBase, HANDSHAKE);
+                    if (top == topOfFile) {
+                        // Schon auf dem letzten Element (oder das Dateiende erst danach erkannt): stehen bleiben. Im
+                        // Folgemodus kann ein Fill weitere Elemente bringen.
+                        retVal = CacheState_t::END_OF_FILE;
+                        ele = data_[oldBase];
+                        requestFill = isFollowing();
+                    } else {
+                        retVal = CacheState_t::CACHE_OVERFLOW;
+                        requestFill = true;
+                    }
+                } else {
+                    if (top == topOfFile && base == ((top - 1) & (capacity() - 1))) {
+                        retVal = CacheState_t::END_OF_FILE;
+                    } else if (top > topOfFile) {
+                        retVal = CacheState_t::CACHE_OVERFLOW;
+                    } else if (fillLevelUp(base, top) <= 1) {  // FillLevel erneut abfragen; knnte schon gendert haben (wenn requestFill den fill im gleichen Kontext aufruft.
+                        retVal = CacheState_t::ALMOST_EMPTY;
+                    }
+                    ele = data_[base];
+                    requestFill = fillLevelUp(base, top) <= fillThreshold(true);
+                    if (top < topOfFile) {
+                        noteLowWater(true, fillLevelUp(base, top));
+                    }
+                    noteRead(true, 1);
                 }
-                ele = data_[base_];
-                requestFill = fillLevelUp() <= DATA_TUPLES_CHACHE_LENGTH / 4;
             }  // lock scope
             if (requestFill) {
                 listener_->requestFill(true);
             }
+            noteState(retVal);
             return retVal;
         }
 
         /**
         * Rckgabe des vorherigen Werts
         * @param[out] ele Der Wert
-        * @return @see CacheState_t
+        * @return @see CacheState_t, @see getNext
         */
         CacheState_t getPrev(T& ele) {
             CacheState_t retVal{ CacheState_t::OK };
             bool requestFill{false};
             {
-                std::lock_guard<std::mutex> lock{mutex_};
-                if (bottom_ == 0 && base_ == 0) {
-                    retVal = retVal = CacheState_t::CACHE_OVERFLOW;
+                auto lock = lockState();
+                const size_t oldBase = base_.load(std::memory_order_relaxed);
+                if (bottom_.load(ACQUIRE) == 0 && oldBase == 0) {
+                    retVal = CacheState_t::CACHE_OVERFLOW;
                 } else {
-                    base_ = (base_ + ((DATA_TUPLES_CHACHE_LENGTH - 1))) % DATA_TUPLES_CHACHE_LENGTH;
-                    ele = data_[base_];
-                    if (bottom_ == 0 && base_ == 0) {
-                        retVal = CacheState_t::END_OF_FILE;
-                    } else if (fillLevelDown() <= 1 && bottom_ > 0) {
-                        retVal = CacheState_t::ALMOST_EMPTY;
+                    const size_t base = (oldBase + ((capacity() - 1))) & (capacity() - 1);
+                    base_.store(base, HANDSHAKE);  // zuerst ankndigen, dann prfen. @see retractTop
+                    const size_t bottom = bottom_.load(HANDSHAKE);
+                    const size_t top = top_.load(HANDSHAKE);
+                    const size_t oldPosition = absolutePosition(oldBase, bottom);
+                    if (LOCK_FREE && (oldPosition <= bottom || oldPosition >= top)) {
+                        base_.store(oldBase, HANDSHAKE);
+                        retVal = CacheState_t::CACHE_OVERFLOW;
+                        requestFill = bottom > 0;
+                    } else {
+                        ele = data_[base];
+                        if (bottom == 0 && base == 0) {
+                            retVal = CacheState_t::END_OF_FILE;
+                        } else if (fillLevelDown(base, bottom) <= 1 && bottom > 0) {
+                            retVal = CacheState_t::ALMOST_EMPTY;
+                        }
+                        requestFill = fillLevelDown(base, bottom) <= fillThreshold(false) && bottom > 0;
+                        if (bottom > 0) {
+                            noteLowWater(false, fillLevelDown(base, bottom));
+                        }
+                        noteRead(false, 1);
+                    }
+                }
+            }  // lock scope
+            if (requestFill) {
+                listener_->requestFill(false);
+            }
+            noteState(retVal);
+            return retVal;
+        }
+
+        /**
+         * Rckgabe der nchsten (bis zu) maxCount Werte in einem Aufruf. Wie maxCount-mal #getNext, aber mit nur einem
+         * Lock, einem Zustand fr den ganzen Block und hchstens einer Fill-Anforderung.
+         * Danach steht die aktuelle Position auf dem letzten Element von span.
+         * @param maxCount Gewnschte Anzahl. Wird auf einen Viertel der Cache-Lnge begrenzt, damit ein gleichzeitig
+         *                 laufendes fillUpwards den Ausschnitt nicht berschreiben kann.
+         * @param[out] span Die Werte. Kann weniger als maxCount Elemente enthalten (auch keines).
+         * @return OK, ALMOST_EMPTY, wenn der Cache nach dem Block leer ist, END_OF_FILE, wenn das letzte Element der
+         *         Datei im Block ist (oder schon vorher erreicht war), CACHE_OVERFLOW, wenn kein Wert vorhanden ist. Dann
+         *         bleibt die Position unverndert.
+         * @pre #setListener ausgefhrt.
+         */
+        CacheState_t getNextSpan(size_t maxCount, Span_t &span) {
+            CacheState_t retVal{ CacheState_t::OK };
+            bool requestFill{false};
+            span = Span_t{};
+            {
+                auto lock = lockState();
+                const size_t oldBase = base_.load(std::memory_order_relaxed);
+                size_t bottom = bottom_.load(ACQUIRE);
+                size_t top = top_.load(ACQUIRE);
+                // ber die Position in der Datei rechnen: fillLevelUp kann einen vollen Cache nicht von einem leeren unterscheiden
+                const size_t position = absolutePosition(oldBase, bottom);
+                const size_t available = position < top ? top - 1 - position : 0;
+                size_t n = std::min({maxCount, available, static_cast<size_t>(capacity() / 4)});
+                const bool atEndOfFile = top == topOfFile_.load(ACQUIRE);
+                if (n > 0) {
+                    const size_t base = (oldBase + n) & (capacity() - 1);
+                    base_.store(base, HANDSHAKE);  // zuerst ankndigen, dann prfen. @see retractBottom
+                    bottom = bottom_.load(HANDSHAKE);
+                    top = top_.load(HANDSHAKE);
+                    if (LOCK_FREE && absolutePosition(oldBase, bottom) + n >= top) {
+                        base_.store(oldBase, HANDSHAKE);
+                        retVal = CacheState_t::CACHE_OVERFLOW;
+                        n = 0;
+                    } else {
+                        makeSpan((oldBase + 1) & (capacity() - 1), n, span);
+                        if (n == available) {
+                            retVal = atEndOfFile ? CacheState_t::END_OF_FILE : CacheState_t::ALMOST_EMPTY;
+                        }
+                    }
+                } else {
+                    retVal = atEndOfFile ? CacheState_t::END_OF_FILE : CacheState_t::CACHE_OVERFLOW;
+                }
+                requestFill = available - n < fillThreshold(true) && (!atEndOfFile || isFollowing());  // wie fillLevelUp() <= fillThreshold danach
+                if (!atEndOfFile) {
+                    noteLowWater(true, available - n + 1);
+                }
+                noteRead(true, n);
+            }  // lock scope
+            if (requestFill) {
+                listener_->requestFill(true);
+            }
+            noteState(retVal);
+            return retVal;
+        }
+
+        /**
+         * Rckgabe der vorherigen (bis zu) maxCount Werte in einem Aufruf. Gegenstck zu #getNextSpan.
+         * Auch hier liegen die Elemente in span aufsteigend; das zuletzt "gelesene" Element ist also das erste in span.
+         * Danach steht die aktuelle Position auf dem ersten Element von span.
+         * @param maxCount Gewnschte Anzahl. Wird auf einen Viertel der Cache-Lnge begrenzt.
+         * @param[out] span Die Werte
+         * @return @see getNextSpan
+         */
+        CacheState_t getPrevSpan(size_t maxCount, Span_t &span) {
+            CacheState_t retVal{ CacheState_t::OK };
+            bool requestFill{false};
+            span = Span_t{};
+            {
+                auto lock = lockState();
+                const size_t oldBase = base_.load(std::memory_order_relaxed);
+                size_t bottom = bottom_.load(ACQUIRE);
+                size_t top = top_.load(ACQUIRE);
+                const size_t position = absolutePosition(oldBase, bottom);
+                const size_t available = position < top ? position - bottom : 0;
+                size_t n = std::min({maxCount, available, static_cast<size_t>(capacity() / 4)});
+                const bool atStartOfFile = bottom == 0;
+                if (n > 0) {
+                    const size_t base = (oldBase - n) & (capacity() - 1);
+                    base_.store(base, HANDSHAKE);  // zuerst ankndigen, dann prfen. @see retractTop
+                    bottom = bottom_.load(HANDSHAKE);
+                    top = top_.load(HANDSHAKE);
+                    const size_t oldPosition = absolutePosition(oldBase, bottom);
+                    if (LOCK_FREE && (oldPosition < bottom + n || oldPosition >= top)) {
+                        base_.store(oldBase, HANDSHAKE);
+                        retVal = CacheState_t::CACHE_OVERFLOW;
+                        n = 0;
+                    } else {
+                        makeSpan(base, n, span);
+                        if (n == available) {
+                            retVal = atStartOfFile ? CacheState_t::END_OF_FILE : CacheState_t::ALMOST_EMPTY;
+                        }
                     }
-                    requestFill = fillLevelDown() <= DATA_TUPLES_CHACHE_LENGTH / 4 && bottom_ > 0;
+                } else {
+                    retVal = atStartOfFile ? CacheState_t::END_OF_FILE : CacheState_t::CACHE_OVERFLOW;
+                }
+                requestFill = available - n < fillThreshold(false) && !atStartOfFile;  // wie fillLevelDown() <= fillThreshold danach
+                if (!atStartOfFile) {
+                    noteLowWater(false, available - n + 1);
                 }
+                noteRead(false, n);
             }  // lock scope
             if (requestFill) {
                 listener_->requestFill(false);
             }
+            noteState(retVal);
             return retVal;
         }
 
-        /** Fllt den Cache aufwrts um einen Viertel der Gesamtlnge. */
+        /**
+        * Wie #getNext, wartet aber, bis der Fller das nchste Element bereitgestellt hat, hchstens timeout lang.
+        * Statt zu pollen oder zu schlafen, wartet der Leser auf die Benachrichtigung nach einem Fill.
+        * Im Folgemodus (#setFollow) wird am Dateiende auf neue Elemente gewartet, bis ein Fill nach #notifyFileGrown
+        * welche bringt.
+        * @return @see getNext. END_OF_FILE, wenn die Position schon auf dem letzten Element steht (im Folgemodus: auch
+        *         nach timeout noch); dann bleibt sie dort und ele ist das letzte Element. CACHE_OVERFLOW nur nach Ablauf
+        *         von timeout, dann ist die Position unverndert.
+        * @pre #setListener ausgefhrt.
+        */
+        template <class Rep, class Period>
+        CacheState_t getNext(T& ele, const std::chrono::duration<Rep, Period> &timeout) {
+            return getWaiting(true, ele, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+        * Wie #getPrev, wartet aber, bis der Fller das vorherige Element bereitgestellt hat, hchstens timeout lang.
+        * @return @see getNext(T&, const std::chrono::duration<Rep, Period>&)
+        */
+        template <class Rep, class Period>
+        CacheState_t getPrev(T& ele, const std::chrono::duration<Rep, Period> &timeout) {
+            return getWaiting(false, ele, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * Sucht ab dem nchsten Element vorwrts das erste, fr das predicate gilt, und stellt die Position darauf.
+         * Geht dazu in Stcken von einem Viertel der Cache-Lnge direkt ber den Ring (wie #getNextSpan), nicht Element
+         * fr Element, und lst unterwegs die Fills aus. Mit SpanKernels::Above bzw. SpanKernels::Below als predicate
+         * wird fr arithmetische T vektorisiert verglichen.
+         *
+         *     buffer.findNext(SpanKernels::Above<float>{0.5f}, value);
+         *
+         * @param predicate bool predicate(const T &)
+         * @param[out] ele das gefundene Element, sonst das Element an der Position danach
+         * @return OK: gefunden. END_OF_FILE: keines bis zum Dateiende, die Position steht auf dem letzten Element.
+         *         CACHE_OVERFLOW: der Cache ist leer, bevor eines gefunden wurde (der Fller kommt nicht nach). Die
+         *         Position steht auf dem zuletzt geprften Element; ein weiterer Aufruf sucht dort weiter.
+         * @pre #setListener ausgefhrt.
+         */
+        template <class PREDICATE>
+        CacheState_t findNext(const PREDICATE &predicate, T& ele) {
+            return findInSpans(true, predicate, ele, std::chrono::steady_clock::time_point{});
+        }
+
+        /**
+         * Wie #findNext, wartet aber auf den Fller, wenn der Cache leer ist, insgesamt hchstens timeout lang.
+         * @return @see findNext. CACHE_OVERFLOW nur nach Ablauf von timeout.
+         */
+        template <class PREDICATE, class Rep, class Period>
+        CacheState_t findNext(const PREDICATE &predicate, T& ele, const std::chrono::duration<Rep, Period> &timeout) {
+            return findInSpans(true, predicate, ele, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * Sucht ab dem vorherigen Element rckwrts das erste, fr das predicate gilt. Gegenstck zu #findNext.
+         * @return @see findNext. END_OF_FILE: keines bis zum Dateianfang, die Position steht auf dem ersten Element.
+         */
+        template <class PREDICATE>
+        CacheState_t findPrev(const PREDICATE &predicate, T& ele) {
+            return findInSpans(false, predicate, ele, std::chrono::steady_clock::time_point{});
+        }
+
+        /** Wie #findPrev, wartet aber auf den Fller, hchstens timeout lang. @see findNext */
+        template <class PREDICATE, class Rep, class Period>
+        CacheState_t findPrev(const PREDICATE &predicate, T& ele, const std::chrono::duration<Rep, Period> &timeout) {
+            return findInSpans(false, predicate, ele, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * Fasst die nchsten (bis zu) count Elemente zusammen (Anzahl, Summe, Minimum, Maximum) und stellt die Position
+         * auf das letzte davon. Wie #findNext in Stcken direkt ber den Ring, fr float, double, int16_t und int32_t
+         * vektorisiert. Nur fr arithmetische T.
+         * @param[out] summary die Zusammenfassung, summary.count Elemente
+         * @return OK: count Elemente zusammengefasst. END_OF_FILE: das letzte Element der Datei ist erreicht.
+         *         CACHE_OVERFLOW: der Cache ist vorher leer geworden.
+         * @pre #setListener ausgefhrt.
+         */
+        CacheState_t reduceNext(size_t count, SpanSummary_t<T> &summary) {
+            return reduceSpans(true, count, summary, std::chrono::steady_clock::time_point{});
+        }
+
+        /** Wie #reduceNext, wartet aber auf den Fller, hchstens timeout lang. */
+        template <class Rep, class Period>
+        CacheState_t reduceNext(size_t count, SpanSummary_t<T> &summary, const std::chrono::duration<Rep, Period> &timeout) {
+            return reduceSpans(true, count, summary, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * Fasst die vorherigen (bis zu) count Elemente zusammen und stellt die Position auf das erste davon.
+         * @return @see reduceNext. END_OF_FILE: das erste Element der Datei ist erreicht.
+         */
+        CacheState_t reducePrev(size_t count, SpanSummary_t<T> &summary) {
+            return reduceSpans(false, count, summary, std::chrono::steady_clock::time_point{});
+        }
+
+        /** Wie #reducePrev, wartet aber auf den Fller, hchstens timeout lang. */
+        template <class Rep, class Period>
+        CacheState_t reducePrev(size_t count, SpanSummary_t<T> &summary, const std::chrono::duration<Rep, Period> &timeout) {
+            return reduceSpans(false, count, summary, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * @return Anzahl bisher abgeschlossener Aufrufe von fillUpwards und fillDownwards. Fr #waitForFill.
+         */
+        size_t fillCount() const {
+            return fillCount_.load(std::memory_order_seq_cst);
+        }
+
+        /**
+         * Wartet, bis nach dem Stand seenFillCount (von #fillCount) ein Fill abgeschlossen ist, hchstens timeout lang.
+         * @return false bei Ablauf von timeout
+         */
+        template <class Rep, class Period>
+        bool waitForFill(size_t seenFillCount, const std::chrono::duration<Rep, Period> &timeout) {
+            return waitForFill(seenFillCount, std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * Fllt den Cache aufwrts um einen Viertel der Gesamtlnge (bzw. um fillSize der Prefetch-Policy).
+         * Danach werden wartende Leser einmal benachrichtigt, auch wenn nichts zu tun war, damit sie neu prfen.
+         */
         void fillUpwards() {
-            std::lock_guard<std::mutex> lock{mutex_};
-            if (fillLevelUp() < DATA_TUPLES_CHACHE_LENGTH / 4) {  // doppelte fillUpwards - Aufrufe abfangen
-                size_t top_in_cache = top_ & (DATA_TUPLES_CHACHE_LENGTH - 1);
-                size_t space_in_cache = (DATA_TUPLES_CHACHE_LENGTH - top_in_cache) % DATA_TUPLES_CHACHE_LENGTH;
+            doFillUpwards();
+            notifyFill();
+        }
+
+        /** Fllt den Cache abwrts um einen Viertel der Gesamtlnge (bzw. um fillSize der Prefetch-Policy). @see fillUpwards */
+        void fillDownwards() {
+            doFillDownwards();
+            notifyFill();
+        }
+
+     private:
+
+        /** @see getNext(T&, const std::chrono::duration<Rep, Period>&) */
+        CacheState_t getWaiting(bool up, T& ele, std::chrono::steady_clock::time_point deadline) {
+            // Im Folgemodus am Dateiende nur einmal anfordern, danach auf Fills von #notifyFileGrown warten. Sonst wrde
+            // jeder Fill ohne neue Daten den nchsten auslsen.
+            bool requested{false};
+            while (true) {
+                // Zuerst den Zhler merken, dann prfen: ein Fill dazwischen lsst waitForFill sofort zurckkehren
+                const size_t seenFillCount = fillCount();
+                const size_t position = this->position();
+                if (up) {
+                    const size_t top = top_.load(ACQUIRE);
+                    if (position + 1 < top) {
+                        const CacheState_t state = getNext(ele);
+                        if (state != CacheState_t::CACHE_OVERFLOW) {
+                            return state;
+                        }
+                        continue;  // LOCK_FREE: vom Fller gerade zurckgenommen
+                    }
+                    if (top == topOfFile_.load(ACQUIRE) && (requested || !isFollowing())) {
+                        if (isFollowing() && waitForFill(seenFillCount, deadline)) {
+                            continue;
+                        }
+                        getCurrent(ele);
+                        noteState(CacheState_t::END_OF_FILE);
+                        return CacheState_t::END_OF_FILE;
+                    }
+                } else {
+                    if (position == 0) {
+                        getCurrent(ele);
+                        noteState(CacheState_t::END_OF_FILE);
+                        return CacheState_t::END_OF_FILE;
+                    }
+                    if (position > bottom_.load(ACQUIRE)) {
+                        const CacheState_t state = getPrev(ele);
+                        if (state != CacheState_t::CACHE_OVERFLOW) {
+                            return state;
+                        }
+                        continue;
+                    }
+                }
+                listener_->requestFill(up);
+                requested = true;
+                if (!waitForFill(seenFillCount, deadline)) {
+                    noteState(CacheState_t::CACHE_OVERFLOW);
+                    return CacheState_t::CACHE_OVERFLOW;
+                }
+            }
+        }
+
+        /**
+         * @see findNext, findPrev
+         * @param deadline time_point{}: nicht warten
+         */
+        template <class PREDICATE>
+        CacheState_t findInSpans(bool up, const PREDICATE &predicate, T& ele, std::chrono::steady_clock::time_point deadline) {
+            while (true) {
+                const size_t seenFillCount = fillCount();
+                Span_t span;
+                const CacheState_t state = up ? getNextSpan(capacity() / 4, span) : getPrevSpan(capacity() / 4, span);
+                // Vorwrts zuerst das erste Stck von vorne, rckwrts zuerst das zweite von hinten
+                size_t hit = span.size();
+                if (up) {
+                    const size_t inFirst = SpanKernels::find(span.first, span.firstLength, predicate, true);
+                    hit = inFirst < span.firstLength ? inFirst : span.firstLength + SpanKernels::find(span.second, span.secondLength, predicate, true);
+                } else {
+                    const size_t inSecond = SpanKernels::find(span.second, span.secondLength, predicate, false);
+                    if (inSecond < span.secondLength) {
+                        hit = span.firstLength + inSecond;
+                    } else {
+                        const size_t inFirst = SpanKernels::find(span.first, span.firstLength, predicate, false);
+                        hit = inFirst < span.firstLength ? inFirst : span.size();
+                    }
+                }
+                if (hit < span.size()) {
+                    // Die Position steht am Ende des Spans in Suchrichtung: zurck auf den Treffer
+                    moveWithinSpan(up, up ? span.size() - 1 - hit : hit);
+                    getCurrent(ele);
+                    return CacheState_t::OK;
+                }
+                if (!waitAfterSpan(state, seenFillCount, deadline)) {
+                    getCurrent(ele);
+                    return state;
+                }
+            }
+        }
+
+        /** @see reduceNext, reducePrev */
+        CacheState_t reduceSpans(bool up, size_t count, SpanSummary_t<T> &summary, std::chrono::steady_clock::time_point deadline) {
+            summary = SpanSummary_t<T>{};
+            while (summary.count < count) {
+                const size_t seenFillCount = fillCount();
+                Span_t span;
+                const size_t n = std::min(count - summary.count, static_cast<size_t>(capacity() / 4));
+                const CacheState_t state = up ? getNextSpan(n, span) : getPrevSpan(n, span);
+                SpanKernels::reduce(span.first, span.firstLength, summary);
+                SpanKernels::reduce(span.second, span.secondLength, summary);
+                if (state == CacheState_t::END_OF_FILE || (summary.count < count && !waitAfterSpan(state, seenFillCount, deadline))) {
+                    return state;
+                }
+            }
+            return CacheState_t::OK;
+        }
+
+        /**
+         * Nach einem Span von #findInSpans bzw. #reduceSpans: weiter, wenn der Cache noch Elemente hat. Ist er leer, mit einem
+         * deadline auf den nchsten Fill warten (angefordert hat ihn getNextSpan bzw. getPrevSpan schon).
+         * @return false: aufhren, state ist das Ergebnis
+         */
+        bool waitAfterSpan(CacheState_t state, size_t seenFillCount, std::chrono::steady_clock::time_point deadline) {
+            switch (state) {
+            case CacheState_t::OK:
+            case CacheState_t::ALMOST_EMPTY:
+                return true;
+            case CacheState_t::CACHE_OVERFLOW:
+                return deadline != std::chrono::steady_clock::time_point{} && waitForFill(seenFillCount, deadline);
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * Geht n Elemente zurck (up) bzw. vor (!up), innerhalb des eben mit getNextSpan bzw. getPrevSpan gelesenen Spans.
+         * Der liegt noch im Cache, der Fller berschreibt hchstens einen Viertel hinter der Position. Darum nur base_ setzen
+         * wie im Fenster-Zweig von seekLocked: kein Lesen, also weder Policy noch Statistik noch Fill-Anforderung.
+         */
+        void moveWithinSpan(bool up, size_t n) {
+            if (n == 0) {
+                return;
+            }
+            auto lock = lockState();
+            const size_t base = base_.load(std::memory_order_relaxed);
+            base_.store((up ? base - n : base + n) & (capacity() - 1), HANDSHAKE);
+        }
+
+        bool waitForFill(size_t seenFillCount, std::chrono::steady_clock::time_point deadline) {
+            std::unique_lock<std::mutex> lock{waitMutex_};
+            waiting_.fetch_add(1, std::memory_order_seq_cst);
+            const bool filled = filled_.wait_until(lock, deadline, [this, seenFillCount] { return fillCount_.load(std::memory_order_seq_cst) != seenFillCount; });
+            waiting_.fetch_sub(1, std::memory_order_relaxed);
+            return filled;
+        }
+
+        /**
+         * Einmal nach jedem Fill. Zhlt fillCount_ hoch und weckt wartende Leser. Ohne Wartende ohne Lock und Systemaufruf:
+         * Leser zhlen waiting_ vor dem Prfen hoch, hier wird nach dem Hochzhlen von fillCount_ geprft (beides seq_cst).
+         */
+        void notifyFill() {
+            fillCount_.fetch_add(1, std::memory_order_seq_cst);
+            if (waiting_.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock{waitMutex_};
+                filled_.notify_all();
+            }
+        }
+
+        /** @see fillUpwards */
+        void doFillUpwards() {
+            auto lock = lockFill();
+            const size_t top = top_.load(std::memory_order_relaxed);
+            const size_t bottom = bottom_.load(std::memory_order_relaxed);
+            // doppelte fillUpwards - Aufrufe abfangen. Im Folgemodus auch am Dateiende lesen, es knnte sich verschoben haben.
+            if (fillLevelUp(base_.load(ACQUIRE), top) < fillThreshold(true) && (top < topOfFile_.load(std::memory_order_relaxed) || isFollowing())) {
+                const auto start = policy_ != nullptr || WITH_STATS ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+                const size_t n = fillSize(true);
+                size_t top_in_cache = top & (capacity() - 1);
+                size_t space_in_cache = (capacity() - top_in_cache) & (capacity() - 1);
                 size_t remaining{0};  // Anzahl, die nach Erreichen der Decke des Caches, am Anfang noch eingefgt werden mssen
-                if (space_in_cache < DATA_TUPLES_CHACHE_LENGTH / 4) {
-                    remaining = DATA_TUPLES_CHACHE_LENGTH / 4 - space_in_cache;
+                if (space_in_cache < n) {
+                    remaining = n - space_in_cache;
                 }
-                top_ += read_with_eof_check(data_ + top_in_cache, sizeof(T), space_in_cache, file_);
-                if (remaining > 0) {
-                    top_ += read_with_eof_check(data_, sizeof(T), remaining, file_);
+                if (!retractBottom(bottom, cacheBottom(top + n))) {
+                    noteRejectedFill(true);
+                    return;
+                }
+                size_t newTop = top + read_with_eof_check(data_ + top_in_cache, sizeof(T), std::min(space_in_cache, n), top);
+                if (remaining > 0 && newTop == top + space_in_cache) {
+                    newTop += read_with_eof_check(data_, sizeof(T), remaining, newTop);
+                }
+                if (newTop < top + n && newTop >= capacity() && newTop - capacity() >= bottom) {
+                    // Am Dateiende kann die Engine den Anfang eines unvollstndigen Elements (z.B. noch im Schreiben) in
+                    // den Platz von newTop geschrieben haben. Dort liegt aber noch das gltige Element newTop - LEN.
+                    const size_t nRestored = engine_->read(data_ + (newTop & (capacity() - 1)), sizeof(T), 1, newTop - capacity());
+                    noteEngineRead(newTop - capacity(), nRestored);
                 }
-                filePointer_ = top_;
-                bottom_ = top_ - DATA_TUPLES_CHACHE_LENGTH;
+                // Erst verffentlichen, wenn die Daten geschrieben sind
+                top_.store(newTop, RELEASE);
+                bottom_.store(cacheBottom(newTop), RELEASE);
+                // Das nchste Viertel kann schon gelesen werden, whrend der Leser dieses konsumiert
+                const size_t topOfFile = topOfFile_.load(std::memory_order_relaxed);
+                if (newTop < topOfFile) {
+                    engine_->prefetch(sizeof(T), std::min(n, topOfFile - newTop), newTop);
+                }
+                noteFill(true, newTop - top, start);
+            } else {
+                noteRejectedFill(true);
             }
         }
-        
-        /** Fllt den Cache abwrts um einen Viertel der Gesamtlnge. */
-        void fillDownwards() {
-            std::lock_guard<std::mutex> lock{mutex_};
-            if (fillLevelDown() <= DATA_TUPLES_CHACHE_LENGTH / 4) {  // doppelte fillDownwards - Aufrufe abfangen
-                size_t bottom_in_cache = bottom_ & (DATA_TUPLES_CHACHE_LENGTH - 1);
+
+        /** @see fillDownwards */
+        void doFillDownwards() {
+            auto lock = lockFill();
+            const size_t top = top_.load(std::memory_order_relaxed);
+            const size_t bottom = bottom_.load(std::memory_order_relaxed);
+            // doppelte fillDownwards - Aufrufe abfangen
+            if (fillLevelDown(base_.load(ACQUIRE), bottom) <= fillThreshold(false) && bottom > 0) {
+                const auto start = policy_ != nullptr || WITH_STATS ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+                const size_t n = std::min(fillSize(false), bottom);  // nicht unter den Dateianfang
+                size_t bottom_in_cache = bottom & (capacity() - 1);
                 size_t space_in_cache = bottom_in_cache;
                 size_t remaining{0};
                 size_t destPtrInCache;
                 size_t nToCopy;
-                if (space_in_cache < DATA_TUPLES_CHACHE_LENGTH / 4) {
+                if (space_in_cache < n) {
                     // there is less than a quarter space left in chache in down direction
-                    remaining = DATA_TUPLES_CHACHE_LENGTH / 4 - space_in_cache;
+                    remaining = n - space_in_cache;
                     destPtrInCache = 0;
                     nToCopy = space_in_cache;
                 } else {
                     // there is plenty of space left in down direction
-                    destPtrInCache = bottom_in_cache - DATA_TUPLES_CHACHE_LENGTH / 4;
-                    nToCopy = DATA_TUPLES_CHACHE_LENGTH / 4;
+                    destPtrInCache = bottom_in_cache - n;
+                    nToCopy = n;
+                }
+                if (!retractTop(top, bottom - n + capacity())) {
+                    noteRejectedFill(false);
+                    return;
                 }
-                const size_t newBottom = bottom_ - nToCopy;
-                const int offset = -static_cast<int>(filePointer_ - newBottom);
-                fseek(file_, offset * sizeof(T), SEEK_CUR);
-                bottom_ -= fread(data_ + destPtrInCache, sizeof(T), nToCopy, file_);
+                const size_t nCopied = engine_->read(data_ + destPtrInCache, sizeof(T), nToCopy, bottom - nToCopy);
+                noteEngineRead(bottom - nToCopy, nCopied);
+                size_t newBottom = bottom - nCopied;
                 // Im zweiten Schritt am oberen Ende den Rest einfllen
                 if (remaining > 0) {
-                    fseek(file_, -static_cast<int>(nToCopy + remaining) * sizeof(T), SEEK_CUR);
-                    bottom_ -= fread(data_ + DATA_TUPLES_CHACHE_LENGTH - remaining, sizeof(T), remaining, file_);
+                    const size_t nRemaining = engine_->read(data_ + capacity() - remaining, sizeof(T), remaining, bottom - n);
+                    noteEngineRead(bottom - n, nRemaining);
+                    newBottom -= nRemaining;
                 }
-                top_ = bottom_ + DATA_TUPLES_CHACHE_LENGTH;
-                filePointer_ = bottom_ + DATA_TUPLES_CHACHE_LENGTH / 4;
+                noteBytesRead((bottom - newBottom) * sizeof(T));
+                // Erst verffentlichen, wenn die Daten geschrieben sind
+                bottom_.store(newBottom, RELEASE);
+                top_.store(std::min(top, newBottom + capacity()), RELEASE);
+                if (newBottom > 0) {
+                    engine_->prefetch(sizeof(T), std::min(n, newBottom), newBottom - std::min(n, newBottom));
+                }
+                noteFill(false, bottom - newBottom, start);
+            } else {
+                noteRejectedFill(false);
             }
         }
 
-     private:
 
         friend class UnitTest1::UnitTest;
         friend class DefaultListener;  // Zugriff auf mutex_
 
+        /** Ordnung beim Lesen bzw. Verffentlichen der Indizes. Mit mutex_ gengt relaxed, dort ordnet der Mutex. */
+        static constexpr std::memory_order ACQUIRE{ LOCK_FREE ? std::memory_order_acquire : std::memory_order_relaxed };
+        static constexpr std::memory_order RELEASE{ LOCK_FREE ? std::memory_order_release : std::memory_order_relaxed };
+        /** Ordnung fr den Handshake zwischen Leser und Fller. Braucht eine totale Ordnung, @see retractBottom */
+        static constexpr std::memory_order HANDSHAKE{ LOCK_FREE ? std::memory_order_seq_cst : std::memory_order_relaxed };
+        static constexpr bool WITH_STATS{ CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS != 0 };
+        /** topOfFile_, solange das Dateiende nicht bekannt ist. Gleich dem "unbekannt" von IReadEngine#size. */
+        static constexpr size_t TOP_OF_FILE_UNKNOWN{ std::numeric_limits<size_t>::max() };
+
+        /** Holt den Cache beim allocator. Nur fr DATA_TUPLES_CHACHE_LENGTH = 0. */
+        void allocateRing(size_t capacity, IRingAllocator *allocator) {
+            static_assert(DATA_TUPLES_CHACHE_LENGTH == 0);  // sonst liegt der Cache im Objekt
+			static_assert(sizeof(T) && !(sizeof(T) & (sizeof(T) - 1)));
+            assert(capacity >= 4 && !(capacity & (capacity - 1)));  // Power of two
+            static DefaultRingAllocator defaultAllocator;
+            allocator_ = allocator != nullptr ? allocator : &defaultAllocator;
+            capacity_ = capacity;
+            memory_ = allocator_->allocate(capacity * sizeof(T));
+            if (memory_.data == nullptr) {
+                throw std::bad_alloc();
+            }
+            data_ = static_cast<T *>(memory_.data);
+        }
+
+#if CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS
+        /** Zhlerstnde fr #stats. Leser und Fller zhlen gleichzeitig, darum relaxed Atomics. */
+        struct Counters_t {
+            struct Histogram_t {
+                std::atomic<uint64_t> buckets[LatencyHistogram_t::N_BUCKETS]{};
+
+                void add(std::chrono::nanoseconds duration) {
+                    const uint64_t ns = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(0, duration.count()));
+                    buckets[LatencyHistogram_t::bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+                }
+
+                void copyTo(LatencyHistogram_t &histogram) const {
+                    for (size_t i = 0; i < LatencyHistogram_t::N_BUCKETS; i++) {
+                        histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+                    }
+                }
+            };
+
+            std::atomic<uint64_t> states[4]{};
+            std::atomic<uint64_t> fills[2]{};
+            std::atomic<uint64_t> rejectedFills[2]{};
+            std::atomic<uint64_t> bytesRead{0};
+            std::atomic<uint64_t> seeks{0};
+            std::atomic<uint64_t> seekCalls{0};
+            std::atomic<uint64_t> rebuilds{0};
+            /** Element-Index hinter dem letzten Lesezugriff auf die Engine, @see noteEngineRead */
+            std::atomic<size_t> readEnd{0};
+            Histogram_t fillLatency;
+            Histogram_t lockHold;
+            /** Nur vom Leser geschrieben */
+            std::atomic<size_t> lowWater[2]{ {std::numeric_limits<size_t>::max()}, {std::numeric_limits<size_t>::max()} };
+        };
+
+        /** std::unique_lock, das beim Freigeben die Haltezeit in Counters_t#lockHold eintrgt */
+        class Lock_t {
+        public:
+
+            Lock_t(std::unique_lock<std::mutex> &&lock, Counters_t &counters) :
+                lock_(std::move(lock)), counters_(&counters), start_(std::chrono::steady_clock::now()) {}
+
+            Lock_t(Lock_t &&other) : lock_(std::move(other.lock_)), counters_(other.counters_), start_(other.start_) {}
+
+            ~Lock_t() {
+                if (lock_.owns_lock()) {
+                    counters_->lockHold.add(std::chrono::steady_clock::now() - start_);
+                }
+            }
+
+        private:
+
+            std::unique_lock<std::mutex> lock_;
+            Counters_t *counters_;
+            std::chrono::steady_clock::time_point start_;
+        };
+#else
+        typedef std::unique_lock<std::mutex> Lock_t;
+#endif
+
+        /** Lock auf mutex_. Im LOCK_FREE-Betrieb ein leeres Lock. */
+        Lock_t lockState() const {
+            return withStats(LOCK_FREE ? std::unique_lock<std::mutex>{} : std::unique_lock<std::mutex>{mutex_});
+        }
+
+        /** Lock auf mutex_ fr alles, was data_ beschreibt. Auch im LOCK_FREE-Betrieb, dort nur zwischen Fills und Neuaufbau. */
+        Lock_t lockFill() const {
+            return withStats(std::unique_lock<std::mutex>{mutex_});
+        }
+
+#if CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS
+        Lock_t withStats(std::unique_lock<std::mutex> &&lock) const {
+            return Lock_t{std::move(lock), counters_};
+        }
+
+        void noteState(CacheState_t state) {
+            counters_.states[static_cast<size_t>(state)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void noteLowWater(bool up, size_t level) {
+            if (level < counters_.lowWater[up].load(std::memory_order_relaxed)) {
+                counters_.lowWater[up].store(level, std::memory_order_relaxed);
+            }
+        }
+
+        /** rebuild: Neuaufbau des Caches in seek, sonst Aufruf von seek */
+        void noteSeek(bool rebuild) {
+            (rebuild ? counters_.rebuilds : counters_.seekCalls).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /** Nach jedem engine_->read: ein Seek, wenn er nicht am Ende des vorherigen begonnen hat */
+        void noteEngineRead(size_t first, size_t nRead) {
+            if (counters_.readEnd.exchange(first + nRead, std::memory_order_relaxed) != first) {
+                counters_.seeks.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void noteRejectedFill(bool up) {
+            counters_.rejectedFills[up].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void noteBytesRead(size_t bytes) {
+            counters_.bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+        }
+#else
+        static Lock_t withStats(std::unique_lock<std::mutex> &&lock) {
+            return std::move(lock);
+        }
+
+        void noteState(CacheState_t) {}
+        void noteLowWater(bool, size_t) {}
+        void noteSeek(bool) {}
+        void noteEngineRead(size_t, size_t) {}
+        void noteRejectedFill(bool) {}
+        void noteBytesRead(size_t) {}
+#endif
+
+        /** Nach einem Fill mit n neuen Elementen, der bei start begonnen hat: an die Policy und in die Statistik */
+        void noteFill(bool up, size_t n, std::chrono::steady_clock::time_point start) {
+            if (policy_ != nullptr || WITH_STATS) {
+                const std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - start;
+                if (policy_ != nullptr) {
+                    policy_->onFill(up, n, duration);
+                }
+#if CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS
+                counters_.fills[up].fetch_add(1, std::memory_order_relaxed);
+                counters_.fillLatency.add(duration);
+#endif
+            }
+        }
+
+        /** @see IPrefetchPolicy#fillThreshold, begrenzt auf 1 .. LEN/2 */
+        size_t fillThreshold(bool up) const {
+            if (policy_ == nullptr) {
+                return capacity() / 4;
+            }
+            return std::min(std::max(policy_->fillThreshold(up, capacity()), static_cast<size_t>(1)), static_cast<size_t>(capacity() / 2));
+        }
+
+        /**
+         * @see IPrefetchPolicy#fillSize, begrenzt auf 1 .. 3/4 LEN - fillThreshold. Mehr wrde beim Fill den Bereich des
+         * Lesers (plus ein Viertel fr Spans) erreichen.
+         */
+        size_t fillSize(bool up) const {
+            if (policy_ == nullptr) {
+                return capacity() / 4;
+            }
+            return std::min(std::max(policy_->fillSize(up, capacity()), static_cast<size_t>(1)), capacity() / 4 * 3 - fillThreshold(up));
+        }
+
+        /** @see IPrefetchPolicy#lookahead, begrenzt auf LEN/4 .. 3/4 LEN */
+        size_t lookahead() const {
+            if (policy_ == nullptr) {
+                return capacity() / 2;
+            }
+            return std::min(std::max(policy_->lookahead(capacity()), static_cast<size_t>(capacity() / 4)), static_cast<size_t>(capacity() / 4 * 3));
+        }
+
+        void noteRead(bool up, size_t n) {
+            if (policy_ != nullptr) {
+                policy_->onRead(up, n);
+            }
+        }
+
+        /**
+         * Rest von #seek: verschiebt base_, wenn elementIndex im Cache liegt, sonst Neuaufbau.
+         * @pre lockFill
+         */
+        CacheState_t seekLocked(size_t elementIndex) {
+            CacheState_t retVal{ CacheState_t::OK };
+            if (elementIndex < bottom_.load(std::memory_order_relaxed) || elementIndex >= top_.load(std::memory_order_relaxed)) {
+                const size_t topOfFile = endOfFile();
+                if (elementIndex >= topOfFile) {
+                    elementIndex = topOfFile - 1;
+                    retVal = CacheState_t::CACHE_OVERFLOW;
+                }
+                const size_t top = recentre(elementIndex);
+                noteSeek(true);
+                if (top <= elementIndex) {
+                    // Dateiende erst jetzt erkannt. Nichts gelesen geht nur mit einer Engine, die ihre Grsse nicht kennt.
+                    assert(top > bottom_.load(std::memory_order_relaxed));
+                    elementIndex = top - 1;
+                    retVal = CacheState_t::CACHE_OVERFLOW;
+                }
+            }
+            base_.store(elementIndex & (capacity() - 1), HANDSHAKE);
+            return retVal;
+        }
+
+        /**
+         * @return Anzahl Elemente der Datei, TOP_OF_FILE_UNKNOWN wenn die Engine es nicht weiss. Ist das Dateiende noch
+         *         nicht erreicht (oder im Folgemodus vielleicht verschoben), wird bei der Engine nachgefragt, damit nicht
+         *         hinter dem Dateiende gelesen wird.
+         * @pre lockFill
+         */
+        size_t endOfFile() {
+            size_t topOfFile = topOfFile_.load(std::memory_order_relaxed);
+            if (topOfFile == TOP_OF_FILE_UNKNOWN || isFollowing()) {
+                topOfFile = engine_->size(sizeof(T));
+                topOfFile_.store(topOfFile, RELEASE);
+            }
+            return topOfFile;
+        }
+
+        /**
+         * Baut den Cache um elementIndex herum neu auf: [elementIndex - (LEN - lookahead), elementIndex + lookahead), unten
+         * beim Dateianfang abgeschnitten. Ohne Prefetch-Policy je eine halbe Cache-Lnge. Element i liegt wie immer bei data_[i % DATA_TUPLES_CHACHE_LENGTH].
+         * Setzt bottom_ und top_, nicht base_.
+         * @return neuer top_. Kleiner oder gleich elementIndex, wenn das Dateiende davor liegt.
+         * @pre lockFill
+         */
+        size_t recentre(size_t elementIndex) {
+            const size_t ahead = lookahead();
+            const size_t bottom = elementIndex - std::min(elementIndex, capacity() - ahead);
+            const size_t n = elementIndex + ahead - bottom;
+            const size_t bottom_in_cache = bottom & (capacity() - 1);
+            const size_t nToCopy = std::min(n, capacity() - bottom_in_cache);
+            // Im LOCK_FREE-Betrieb liest der Leser seine Position nach dem Ankndigen wieder gegen diesen Bereich
+            bottom_.store(bottom, HANDSHAKE);
+            top_.store(bottom, HANDSHAKE);
+            size_t top = bottom + read_with_eof_check(data_ + bottom_in_cache, sizeof(T), nToCopy, bottom);
+            if (top == bottom + nToCopy && n > nToCopy) {
+                top += read_with_eof_check(data_, sizeof(T), n - nToCopy, top);
+            }
+            top_.store(top, RELEASE);
+            const size_t topOfFile = topOfFile_.load(std::memory_order_relaxed);
+            if (top < topOfFile) {
+                engine_->prefetch(sizeof(T), std::min(fillSize(true), topOfFile - top), top);
+            }
+            return top;
+        }
+
         /** Anzahl Elemente im Cache in Aufwrts-Richtung. Inkl. Current Element */
         size_t fillLevelUp() const {
-            return ((top_ % DATA_TUPLES_CHACHE_LENGTH) + DATA_TUPLES_CHACHE_LENGTH - base_) % DATA_TUPLES_CHACHE_LENGTH;
+            return fillLevelUp(base_.load(std::memory_order_relaxed), top_.load(std::memory_order_relaxed));
+        }
+
+        size_t fillLevelUp(size_t base, size_t top) const {
+            return ((top & (capacity() - 1)) + capacity() - base) & (capacity() - 1);
         }
 
         /** Anzahl Elemente im Cache in Abwrts-Richtung. Inkl. Current Element */
         size_t fillLevelDown() const {
-            return static_cast<size_t>((static_cast<int>(base_) - static_cast<int>(bottom_)) & (DATA_TUPLES_CHACHE_LENGTH - 1)) + 1;
+            return fillLevelDown(base_.load(std::memory_order_relaxed), bottom_.load(std::memory_order_relaxed));
+        }
+
+        size_t fillLevelDown(size_t base, size_t bottom) const {
+            return ((base - bottom) & (capacity() - 1)) + 1;
+        }
+
+        /** Element-Index in der Datei zum Index base im Cache, wenn bottom der unterste Index im Cache ist. */
+        size_t absolutePosition(size_t base, size_t bottom) const {
+            return bottom + ((base - bottom) & (capacity() - 1));
+        }
+
+        /** Unterster Element-Index, der im Cache noch Platz hat, wenn top der oberste ist. Nie unter 0. */
+        size_t cacheBottom(size_t top) const {
+            return top > capacity() ? top - capacity() : 0;
+        }
+
+        /**
+         * Nimmt vor dem berschreiben die Elemente [bottom, newBottom) aus dem gltigen Bereich.
+         * Im LOCK_FREE-Betrieb ist das ein Handshake mit dem Leser: Der Leser kndigt seine neue Position in base_ an und
+         * liest danach bottom_ und top_, hier wird zuerst bottom_ gesetzt und danach base_ gelesen (alles seq_cst).
+         * Damit sieht entweder der Leser den neuen bottom_, oder hier wird seine Position gesehen.
+         * @return false, wenn der Leser (inkl. eines Spans von bis zu einem Viertel) noch im Bereich steht. Dann darf nicht
+         *         gefllt werden; der Leser fordert wieder an.
+         */
+        bool retractBottom(size_t bottom, size_t newBottom) {
+            if (!LOCK_FREE || newBottom <= bottom) {  // mit mutex_ kann der Leser nicht dazwischen
+                return true;
+            }
+            bottom_.store(newBottom, HANDSHAKE);
+            if (absolutePosition(base_.load(HANDSHAKE), bottom) < newBottom + capacity() / 4) {
+                bottom_.store(bottom, RELEASE);
+                return false;
+            }
+            return true;
         }
 
-        size_t read_with_eof_check(void *data, size_t elementSize, size_t N, FILE *f) {
-            if (N > topOfFile_ - top_) {
-                N = topOfFile_ - top_;
+        /** Wie #retractBottom fr das obere Ende: Nimmt [newTop, top) aus dem gltigen Bereich. */
+        bool retractTop(size_t top, size_t newTop) {
+            if (!LOCK_FREE || newTop >= top) {
+                return true;
+            }
+            top_.store(newTop, HANDSHAKE);
+            if (absolutePosition(base_.load(HANDSHAKE), bottom_.load(std::memory_order_relaxed)) + capacity() / 4 >= newTop) {
+                top_.store(top, RELEASE);
+                return false;
             }
-            size_t nRead = fread(data, elementSize, N, f);
+            return true;
+        }
+
+        /** Teilt n Elemente ab Index start im Cache am Ende von data_ in die zwei Stcke von span auf. */
+        void makeSpan(size_t start, size_t n, Span_t &span) const {
+            span.first = data_ + start;
+            span.firstLength = std::min(n, capacity() - start);
+            span.second = data_;
+            span.secondLength = n - span.firstLength;
+        }
+
+
+        /**
+         * Liest N Elemente, aber nicht ber topOfFile_ hinaus. Setzt topOfFile_, wenn das Dateiende erreicht wird.
+         * Im Folgemodus wird auch ber topOfFile_ hinaus gelesen; kommen mehr Elemente, gilt das Dateiende wieder als unbekannt.
+         * @param first Element-Index in der Datei des ersten zu lesenden Elements
+         */
+        size_t read_with_eof_check(void *data, size_t elementSize, size_t N, size_t first) {
+            const size_t topOfFile = topOfFile_.load(std::memory_order_relaxed);
+            const bool follow = isFollowing();
+            if (N > topOfFile - first && !follow) {
+                N = topOfFile - first;
+            }
+            size_t nRead = engine_->read(data, elementSize, N, first);
+            noteEngineRead(first, nRead);
+            noteBytesRead(nRead * elementSize);
             if (nRead < N) {
-                assert(topOfFile_ == std::numeric_limits<unsigned int>::max());  // sollte nur 1x hier reinkommen.
-                topOfFile_ = top_ + nRead;
+                assert(follow || topOfFile == TOP_OF_FILE_UNKNOWN);  // sollte nur 1x hier reinkommen.
+                topOfFile_.store(first + nRead, RELEASE);
+            } else if (follow && first + nRead > topOfFile) {
+                topOfFile_.store(TOP_OF_FILE_UNKNOWN, RELEASE);
             }
             return nRead;
         }
 
-        T data_[DATA_TUPLES_CHACHE_LENGTH];
-        FILE *file_;
+        /** Der Cache. Zeigt auf inlineData_ oder bei DATA_TUPLES_CHACHE_LENGTH = 0 auf memory_. */
+        T *data_;
+        T inlineData_[DATA_TUPLES_CHACHE_LENGTH != 0 ? DATA_TUPLES_CHACHE_LENGTH : 1];
+        /** Nur bei DATA_TUPLES_CHACHE_LENGTH = 0 */
+        size_t capacity_{DATA_TUPLES_CHACHE_LENGTH};
+        IRingAllocator *allocator_{nullptr};
+        RingMemory_t memory_;
+        /** Engine fr den Konstruktor mit FILE*. Sonst unbenutzt. */
+        StdioReadEngine stdioEngine_;
+        IReadEngine *engine_;
         IBackgroundTaskListener *listener_;
+        IPrefetchPolicy *policy_{nullptr};
+        /** @see setFollow */
+        std::atomic<bool> follow_{false};
         /** Totale Anzahl Elemente im File. Wird runtergesetzt, sobald EOF erreicht wird. */
-        size_t topOfFile_{ std::numeric_limits<unsigned int>::max() };
-        /** Lese-Pointer im Cache. Index, der bei getNext ausgegeben wird. */
-        size_t base_;
-        /** Lese-Pointer in der Datei. Merkt sich, wo der Lese-Pointer der geffneten Datei steht. Eigentlich das, was ftell zurckgeben wrde. */
-        size_t filePointer_;
-        /** hchster Element-Index aus der Datei, der im Cache. Genauer gesagt: 1 hher als der oberste, gltige Wert. */
-        size_t top_;
-        /** Niedrigster Element-Index aus der Datei, der im Cache gespeichert ist. */
-        size_t bottom_;
-        std::mutex mutex_;
+        std::atomic<size_t> topOfFile_{ TOP_OF_FILE_UNKNOWN };
+        /** Lese-Pointer im Cache. Index, der bei getNext ausgegeben wird. Wird nur vom Leser geschrieben. */
+        std::atomic<size_t> base_;
+
+        /** hchster Element-Index aus der Datei, der im Cache. Genauer gesagt: 1 hher als der oberste, gltige Wert. Wird nur vom Fller geschrieben. */
+        std::atomic<size_t> top_;
+        /** Niedrigster Element-Index aus der Datei, der im Cache gespeichert ist. Wird nur vom Fller geschrieben. */
+        std::atomic<size_t> bottom_;
+        mutable std::mutex mutex_;
+        /** Anzahl abgeschlossener Fills, @see notifyFill */
+        std::atomic<size_t> fillCount_{0};
+        /** Anzahl Leser in waitForFill */
+        std::atomic<unsigned int> waiting_{0};
+        std::mutex waitMutex_;
+        std::condition_variable filled_;
+#if CIRCULARBIDIRECTIONALFILEREADERBUFFER_STATS
+        mutable Counters_t counters_;
+#endif
 };
 
+/**
+ * CircularBidirectionalFilereaderBuffer mit der Lnge des Caches als Konstruktor-Parameter. Eine Instanziierung fr alle
+ * Lngen; der Cache kommt vom IRingAllocator.
+ */
+template <class T, bool LOCK_FREE = false>
+using DynamicFilereaderBuffer = CircularBidirectionalFilereaderBuffer<T, 0, LOCK_FREE>;
+
 #endif
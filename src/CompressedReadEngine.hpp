@@ -0,0 +1,372 @@
+
+#ifndef COMPRESSEDREADENGINE_HPP_
+#define COMPRESSEDREADENGINE_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * Block-komprimiertes Dateiformat fr Arrays aus Elementen fester Grsse, deren Werte sich von Element zu Element wenig
+ * ndern (z.B. Messwerte).
+ *
+ * Aufbau (Zahlen in der Byte-Reihenfolge der Maschine, wie die Elemente in den Rohdateien):
+ *
+ *     Header_t | Block 0 | Block 1 | ... | Index: nBlocks + 1 Offsets (uint64_t) | Trailer_t
+ *
+ * Jeder Block enthlt blockLength Elemente (der letzte weniger) und ist fr sich dekodierbar. Ein Element wird in
+ * Wrter zu 8, 4, 2 oder 1 Bytes zerlegt (das grsste, das die Elementgrsse teilt). Jedes Wort wird als Differenz zum
+ * selben Wort des vorigen Elements gespeichert (das erste Element eines Blocks zur 0), Zickzack-kodiert (kleine
+ * negative Differenzen werden kleine Zahlen) und als Varint mit 7 Bits pro Byte geschrieben.
+ *
+ * Der Index am Ende enthlt den Offset jedes Blocks in der Datei und als letzten Eintrag den Offset des Index selbst,
+ * so dass auch die Lnge jedes Blocks bekannt ist. Damit ist jeder Block direkt adressierbar: rckwrts lesen
+ * (fillDownwards) kostet dasselbe wie vorwrts. Geschrieben wird mit CompressedFormat::Writer, gelesen mit
+ * CompressedReadEngine.
+ */
+class CompressedFormat {
+public:
+
+    /** "CBFZ" */
+    static constexpr uint32_t MAGIC{ 0x5A464243u };
+    static constexpr uint32_t VERSION{ 1u };
+
+    struct Header_t {
+        uint32_t magic;
+        uint32_t version;
+        /** Grsse eines Elements in Bytes */
+        uint32_t elementSize;
+        /** Elemente pro Block */
+        uint32_t blockLength;
+        /** Elemente in der Datei */
+        uint64_t nElements;
+    };
+
+    struct Trailer_t {
+        /** Offset des Index in der Datei */
+        uint64_t indexOffset;
+        uint64_t nBlocks;
+        uint32_t magic;
+        uint32_t reserved;
+    };
+
+    /** Hchstens so viele Bytes braucht ein kodiertes Element */
+    static size_t maxEncodedSize(size_t elementSize) {
+        return elementSize / wordSize(elementSize) * MAX_VARINT_BYTES;
+    }
+
+    /** Hngt count Elemente als einen Block an out an. */
+    static void encodeBlock(const void *elements, size_t elementSize, size_t count, std::vector<uint8_t> &out) {
+        switch (wordSize(elementSize)) {
+        case 8: encode<uint64_t>(elements, elementSize, count, out); break;
+        case 4: encode<uint32_t>(elements, elementSize, count, out); break;
+        case 2: encode<uint16_t>(elements, elementSize, count, out); break;
+        default: encode<uint8_t>(elements, elementSize, count, out); break;
+        }
+    }
+
+    /**
+     * Dekodiert einen Block mit count Elementen.
+     * @return false, wenn die length Bytes in in nicht genau count Elemente ergeben (beschdigte Datei)
+     */
+    static bool decodeBlock(const uint8_t *in, size_t length, size_t elementSize, size_t count, void *elements) {
+        switch (wordSize(elementSize)) {
+        case 8: return decode<uint64_t>(in, length, elementSize, count, elements);
+        case 4: return decode<uint32_t>(in, length, elementSize, count, elements);
+        case 2: return decode<uint16_t>(in, length, elementSize, count, elements);
+        default: return decode<uint8_t>(in, length, elementSize, count, elements);
+        }
+    }
+
+    /**
+     * Schreibt eine komprimierte Datei. Die Elemente kommen in beliebig grossen Stcken mit #write, #finish schreibt den
+     * letzten Block, den Index und den Trailer und trgt die Anzahl Elemente im Header nach.
+     *
+     *     CompressedFormat::Writer writer{out, sizeof(myDataType), 4096};
+     *     while ((n = fread(elements, sizeof(myDataType), 4096, in)) > 0) {
+     *         writer.write(elements, n);
+     *     }
+     *     writer.finish();
+     */
+    class Writer {
+    public:
+
+        /**
+         * @param file zum Schreiben (binr) geffnete, leere Datei. Bleibt im Besitz des Aufrufers; muss seekbar sein.
+         * @param elementSize Grsse eines Elements in Bytes
+         * @param blockLength Elemente pro Block
+         */
+        Writer(FILE *file, size_t elementSize, size_t blockLength) :
+            file_(file), elementSize_(elementSize), blockLength_(blockLength) {
+            assert(elementSize > 0 && blockLength > 0);
+            pending_.reserve(blockLength * elementSize);
+            header_.magic = MAGIC;
+            header_.version = VERSION;
+            header_.elementSize = static_cast<uint32_t>(elementSize);
+            header_.blockLength = static_cast<uint32_t>(blockLength);
+            header_.nElements = 0;
+            ok_ = fwrite(&header_, sizeof(header_), 1, file_) == 1;
+            offset_ = sizeof(header_);
+        }
+
+        /** @return false, wenn das Schreiben fehlgeschlagen ist (auch frher) */
+        bool write(const void *elements, size_t count) {
+            const char *p = static_cast<const char *>(elements);
+            while (count > 0 && ok_) {
+                const size_t n = std::min(count, blockLength_ - pending_.size() / elementSize_);
+                pending_.insert(pending_.end(), p, p + n * elementSize_);
+                p += n * elementSize_;
+                count -= n;
+                if (pending_.size() == blockLength_ * elementSize_) {
+                    flushBlock();
+                }
+            }
+            return ok_;
+        }
+
+        /** @return false, wenn das Schreiben fehlgeschlagen ist */
+        bool finish() {
+            if (!pending_.empty()) {
+                flushBlock();
+            }
+            Trailer_t trailer;
+            trailer.indexOffset = offset_;
+            trailer.nBlocks = index_.size();
+            trailer.magic = MAGIC;
+            trailer.reserved = 0;
+            index_.push_back(offset_);
+            ok_ = ok_ && fwrite(index_.data(), sizeof(uint64_t), index_.size(), file_) == index_.size();
+            ok_ = ok_ && fwrite(&trailer, sizeof(trailer), 1, file_) == 1;
+            ok_ = ok_ && fseek(file_, 0, SEEK_SET) == 0 && fwrite(&header_, sizeof(header_), 1, file_) == 1;
+            ok_ = ok_ && fflush(file_) == 0;
+            return ok_;
+        }
+
+        /** @return bisher geschriebene Bytes ohne Index und Trailer */
+        uint64_t bytesWritten() const {
+            return offset_;
+        }
+
+    private:
+
+        void flushBlock() {
+            const size_t count = pending_.size() / elementSize_;
+            encoded_.clear();
+            encodeBlock(pending_.data(), elementSize_, count, encoded_);
+            index_.push_back(offset_);
+            ok_ = ok_ && fwrite(encoded_.data(), 1, encoded_.size(), file_) == encoded_.size();
+            offset_ += encoded_.size();
+            header_.nElements += count;
+            pending_.clear();
+        }
+
+        FILE *file_;
+        const size_t elementSize_;
+        const size_t blockLength_;
+        Header_t header_;
+        /** Elemente des angefangenen Blocks */
+        std::vector<char> pending_;
+        std::vector<uint8_t> encoded_;
+        /** Offsets der geschriebenen Blcke */
+        std::vector<uint64_t> index_;
+        uint64_t offset_{0};
+        bool ok_{true};
+    };
+
+private:
+
+    /** Varint eines uint64_t */
+    static constexpr size_t MAX_VARINT_BYTES{ 10u };
+
+    static size_t wordSize(size_t elementSize) {
+        return elementSize % 8 == 0 ? 8 : elementSize % 4 == 0 ? 4 : elementSize % 2 == 0 ? 2 : 1;
+    }
+
+    template <class WORD>
+    static void encode(const void *elements, size_t elementSize, size_t count, std::vector<uint8_t> &out) {
+        const size_t nWords = elementSize / sizeof(WORD);
+        const char *p = static_cast<const char *>(elements);
+        std::vector<WORD> previous(nWords, 0);
+        out.reserve(out.size() + count * maxEncodedSize(elementSize));
+        for (size_t i = 0; i < count; i++) {
+            for (size_t w = 0; w < nWords; w++, p += sizeof(WORD)) {
+                WORD word;
+                memcpy(&word, p, sizeof(WORD));
+                const WORD delta = static_cast<WORD>(word - previous[w]);
+                previous[w] = word;
+                // Zickzack: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+                uint64_t zigzag = static_cast<WORD>(static_cast<WORD>(delta << 1) ^ static_cast<WORD>(0 - (delta >> (8 * sizeof(WORD) - 1))));
+                while (zigzag >= 0x80u) {
+                    out.push_back(static_cast<uint8_t>(zigzag | 0x80u));
+                    zigzag >>= 7;
+                }
+                out.push_back(static_cast<uint8_t>(zigzag));
+            }
+        }
+    }
+
+    template <class WORD>
+    static bool decode(const uint8_t *in, size_t length, size_t elementSize, size_t count, void *elements) {
+        const size_t nWords = elementSize / sizeof(WORD);
+        const uint8_t *end = in + length;
+        char *p = static_cast<char *>(elements);
+        std::vector<WORD> previous(nWords, 0);
+        for (size_t i = 0; i < count; i++) {
+            for (size_t w = 0; w < nWords; w++, p += sizeof(WORD)) {
+                uint64_t zigzag = 0;
+                unsigned int shift = 0;
+                uint8_t byte;
+                do {
+                    if (in == end || shift >= 8 * sizeof(WORD)) {
+                        return false;
+                    }
+                    byte = *in++;
+                    zigzag |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+                    shift += 7;
+                } while ((byte & 0x80u) != 0);
+                const WORD delta = static_cast<WORD>(static_cast<WORD>(zigzag >> 1) ^ static_cast<WORD>(0 - static_cast<WORD>(zigzag & 1u)));
+                previous[w] = static_cast<WORD>(previous[w] + delta);
+                memcpy(p, &previous[w], sizeof(WORD));
+            }
+        }
+        return in == end;
+    }
+};
+
+/**
+ * IReadEngine fr Dateien im CompressedFormat. Liest die komprimierten Blcke ber eine andere Engine (byteweise, mit
+ * elementSize 1) und dekodiert sie in #read, also im Thread des Fllers; fr den Leser des Buffers ndert sich nichts.
+ *
+ * Ein Fill, der ganze Blcke abdeckt, wird direkt in den Cache dekodiert. Angeschnittene Blcke werden in einen
+ * Zwischenpuffer dekodiert, der den zuletzt dekodierten Block hlt; die Fill-Grenzen des Buffers und die Blockgrenzen
+ * der Datei mssen also nicht bereinstimmen, Blcke von der Grsse eines Viertels des Caches passen aber am besten.
+ *
+ * Wie die anderen Engines nur aus einem Thread gleichzeitig verwenden.
+ *
+ *     PreadReadEngine disk{fd};  // fd: komprimierte Datei
+ *     CompressedReadEngine engine{disk};
+ *     assert(engine.isValid());
+ *     myBufferType buffer{engine};
+ */
+class CompressedReadEngine : public IReadEngine {
+public:
+
+    /** @param engine liest die komprimierte Datei. Muss lnger leben als diese und ihre Grsse kennen. */
+    CompressedReadEngine(IReadEngine &engine) : engine_(engine) {
+        const size_t fileBytes = engine_.size(1);
+        CompressedFormat::Trailer_t trailer;
+        if (fileBytes == std::numeric_limits<size_t>::max() || fileBytes < sizeof(header_) + sizeof(trailer)
+            || engine_.read(&header_, 1, sizeof(header_), 0) != sizeof(header_)
+            || engine_.read(&trailer, 1, sizeof(trailer), fileBytes - sizeof(trailer)) != sizeof(trailer)
+            || header_.magic != CompressedFormat::MAGIC || header_.version != CompressedFormat::VERSION
+            || trailer.magic != CompressedFormat::MAGIC || header_.elementSize == 0 || header_.blockLength == 0
+            || trailer.nBlocks != (header_.nElements + header_.blockLength - 1) / header_.blockLength) {
+            return;
+        }
+        index_.resize(static_cast<size_t>(trailer.nBlocks) + 1);
+        const size_t indexBytes = index_.size() * sizeof(uint64_t);
+        if (engine_.read(index_.data(), 1, indexBytes, static_cast<size_t>(trailer.indexOffset)) != indexBytes
+            || index_.back() != trailer.indexOffset) {
+            index_.clear();
+            return;
+        }
+        decoded_.resize(static_cast<size_t>(header_.blockLength) * header_.elementSize);
+        valid_ = true;
+    }
+
+    CompressedReadEngine(const CompressedReadEngine &) = delete;
+    CompressedReadEngine &operator=(const CompressedReadEngine &) = delete;
+
+    /** @return false, wenn die Datei nicht im CompressedFormat ist. Dann liefert #read nichts und #size 0. */
+    bool isValid() const {
+        return valid_;
+    }
+
+    /** @return Grsse eines Elements laut Header */
+    size_t elementSize() const {
+        return header_.elementSize;
+    }
+
+    /** @return Bytes der komprimierten Blcke (ohne Header, Index und Trailer) */
+    uint64_t compressedBytes() const {
+        return valid_ ? index_.back() - index_.front() : 0;
+    }
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        assert(!valid_ || elementSize == header_.elementSize);
+        char *p = static_cast<char *>(dest);
+        const size_t end = std::min<size_t>(first + count, valid_ ? static_cast<size_t>(header_.nElements) : 0);
+        size_t position = first;
+        while (position < end) {
+            const size_t block = position / header_.blockLength;
+            const size_t blockFirst = block * header_.blockLength;
+            const size_t blockCount = std::min<size_t>(header_.blockLength, static_cast<size_t>(header_.nElements) - blockFirst);
+            const size_t inBlock = position - blockFirst;
+            const size_t n = std::min(end - position, blockCount - inBlock);
+            if (n == blockCount) {
+                if (!load(block, blockCount, p)) {
+                    break;
+                }
+            } else {
+                if (block != decodedBlock_) {
+                    decodedBlock_ = NO_BLOCK;
+                    if (!load(block, blockCount, decoded_.data())) {
+                        break;
+                    }
+                    decodedBlock_ = block;
+                }
+                memcpy(p, decoded_.data() + inBlock * elementSize, n * elementSize);
+            }
+            p += n * elementSize;
+            position += n;
+        }
+        return position - first;
+    }
+
+    /** Gibt die komprimierten Bytes der betroffenen Blcke als Hinweis an die Engine weiter */
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        if (!valid_ || count == 0 || first >= header_.nElements) {
+            return;
+        }
+        (void)elementSize;
+        const size_t firstBlock = first / header_.blockLength;
+        const size_t endBlock = std::min(index_.size() - 1, (first + count + header_.blockLength - 1) / header_.blockLength);
+        engine_.prefetch(1, static_cast<size_t>(index_[endBlock] - index_[firstBlock]), static_cast<size_t>(index_[firstBlock]));
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        assert(!valid_ || elementSize == header_.elementSize);
+        (void)elementSize;
+        return valid_ ? static_cast<size_t>(header_.nElements) : 0;
+    }
+
+private:
+
+    static constexpr size_t NO_BLOCK{ std::numeric_limits<size_t>::max() };
+
+    /** Liest und dekodiert den Block nach dest. @return false bei einem Lesefehler oder einem beschdigten Block */
+    bool load(size_t block, size_t count, void *dest) {
+        const size_t length = static_cast<size_t>(index_[block + 1] - index_[block]);
+        compressed_.resize(length);
+        return engine_.read(compressed_.data(), 1, length, static_cast<size_t>(index_[block])) == length
+            && CompressedFormat::decodeBlock(compressed_.data(), length, header_.elementSize, count, dest);
+    }
+
+    IReadEngine &engine_;
+    CompressedFormat::Header_t header_{};
+    /** Offsets der Blcke, als letzter der des Index */
+    std::vector<uint64_t> index_;
+    std::vector<uint8_t> compressed_;
+    /** Zuletzt (angeschnitten) gelesener Block */
+    std::vector<char> decoded_;
+    size_t decodedBlock_{NO_BLOCK};
+    bool valid_{false};
+};
+
+#endif
@@ -0,0 +1,363 @@
+#ifndef DECODINGREADENGINE_HPP_
+#define DECODINGREADENGINE_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * Umwandlungen ganzer Blcke, wie sie beim Dekodieren von Rohdateien anfallen, vektorisiert mit AVX2, SSSE3 bzw. SSE2
+ * und mit einem skalaren Rest bzw. Ersatz. Ein- und Ausgabe brauchen keine Ausrichtung.
+ * @see DecodingReadEngine, CIRCULARBIDIRECTIONALFILEREADERBUFFER_SIMD in SpanKernels.hpp
+ */
+class DecodeKernels {
+public:
+
+    /** @return "AVX2", "SSSE3", "SSE2" oder "scalar": die beste Variante, mit der bersetzt wurde */
+    static const char *instructionSet() {
+        return SpanKernels::instructionSet();
+    }
+
+    /**
+     * Kehrt die Byte-Reihenfolge von n Wrtern zu WORD Bytes um (big-endian <-> little-endian).
+     * in und out drfen gleich sein, sich sonst aber nicht berlappen.
+     * @tparam WORD 2, 4 oder 8
+     */
+    template <size_t WORD>
+    static void byteSwap(const void *in, void *out, size_t n) {
+        static_assert(WORD == 2 || WORD == 4 || WORD == 8, "DecodeKernels::byteSwap: Wrter zu 2, 4 oder 8 Bytes");
+        const char *src = static_cast<const char *>(in);
+        char *dst = static_cast<char *>(out);
+        const size_t bytes = n * WORD;
+        size_t b = 0;
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+        const __m256i mask256 = _mm256_broadcastsi128_si256(swapMask<WORD>());
+        for (; b + 32 <= bytes; b += 32) {
+            store256(dst + b, _mm256_shuffle_epi8(load256(src + b), mask256));
+        }
+#endif
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSSE3)
+        const __m128i mask = swapMask<WORD>();
+        for (; b + 16 <= bytes; b += 16) {
+            store128(dst + b, _mm_shuffle_epi8(load128(src + b), mask));
+        }
+#elif defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+        for (; b + 16 <= bytes; b += 16) {
+            store128(dst + b, swapWords<WORD>(load128(src + b)));
+        }
+#endif
+        for (; b < bytes; b += WORD) {
+            char word[WORD];
+            memcpy(word, src + b, WORD);
+            for (size_t j = 0; j < WORD; j++) {
+                dst[b + j] = word[WORD - 1 - j];
+            }
+        }
+    }
+
+    /**
+     * Wandelt n int16_t in float um: out[i] = in[i] * scale + offset.
+     * @param in n int16_t
+     * @param out n float. Darf in nicht berlappen.
+     * @param swapBytes true: die Werte in in haben die andere Byte-Reihenfolge als die Maschine (z.B. big-endian auf x86)
+     */
+    static void int16ToFloat(const void *in, void *out, size_t n, float scale, float offset, bool swapBytes) {
+        const char *src = static_cast<const char *>(in);
+        char *dst = static_cast<char *>(out);
+        size_t i = 0;
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+        {
+            const __m256i mask = _mm256_broadcastsi128_si256(swapMask<2>());
+            const __m256 s = _mm256_set1_ps(scale);
+            const __m256 o = _mm256_set1_ps(offset);
+            for (; i + 16 <= n; i += 16) {
+                __m256i x = load256(src + 2 * i);
+                if (swapBytes) {
+                    x = _mm256_shuffle_epi8(x, mask);
+                }
+                const __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x));
+                const __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1));
+                _mm256_storeu_ps(reinterpret_cast<float *>(dst + 4 * i), _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), s), o));
+                _mm256_storeu_ps(reinterpret_cast<float *>(dst + 4 * i + 32), _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), s), o));
+            }
+        }
+#endif
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+        {
+            const __m128 s = _mm_set1_ps(scale);
+            const __m128 o = _mm_set1_ps(offset);
+            for (; i + 8 <= n; i += 8) {
+                __m128i x = load128(src + 2 * i);
+                if (swapBytes) {
+                    x = swapWords<2>(x);
+                }
+                // Jedes int16 in die obere Hlfte eines int32 und arithmetisch zurckschieben: vorzeichenrichtig erweitert
+                const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+                const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+                _mm_storeu_ps(reinterpret_cast<float *>(dst + 4 * i), _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), s), o));
+                _mm_storeu_ps(reinterpret_cast<float *>(dst + 4 * i + 16), _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), s), o));
+            }
+        }
+#endif
+        for (; i < n; i++) {
+            uint16_t word;
+            memcpy(&word, src + 2 * i, sizeof(word));
+            if (swapBytes) {
+                word = static_cast<uint16_t>((word >> 8) | (word << 8));
+            }
+            const float value = static_cast<float>(static_cast<int16_t>(word)) * scale + offset;
+            memcpy(dst + 4 * i, &value, sizeof(value));
+        }
+    }
+
+    /**
+     * Transponiert n Datenstze aus je channels Feldern zu WORD Bytes (array of structs) in channels Arrays
+     * (struct of arrays): Feld c von Datensatz i kommt nach out[c][i].
+     * Vektorisiert fr 2 und 4 Felder, sonst skalar.
+     * @param in n * channels Felder, Datensatz fr Datensatz
+     * @param out channels Zeiger auf je n Felder. Drfen in nicht berlappen.
+     * @tparam WORD 2 oder 4
+     */
+    template <size_t WORD>
+    static void deinterleave(const void *in, size_t channels, size_t n, void *const *out) {
+        static_assert(WORD == 2 || WORD == 4, "DecodeKernels::deinterleave: Felder zu 2 oder 4 Bytes");
+        const char *src = static_cast<const char *>(in);
+        size_t i = 0;
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+        char *dst[4]{};
+        for (size_t c = 0; c < std::min<size_t>(channels, 4); c++) {
+            dst[c] = static_cast<char *>(out[c]);
+        }
+        if (WORD == 4 && channels == 2) {
+            for (; i + 4 <= n; i += 4) {
+                const __m128 a = _mm_castsi128_ps(load128(src + 8 * i));
+                const __m128 b = _mm_castsi128_ps(load128(src + 8 * i + 16));
+                store128(dst[0] + 4 * i, _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))));
+                store128(dst[1] + 4 * i, _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+            }
+        } else if (WORD == 4 && channels == 4) {
+            for (; i + 4 <= n; i += 4) {
+                __m128 r0 = _mm_castsi128_ps(load128(src + 16 * i));
+                __m128 r1 = _mm_castsi128_ps(load128(src + 16 * i + 16));
+                __m128 r2 = _mm_castsi128_ps(load128(src + 16 * i + 32));
+                __m128 r3 = _mm_castsi128_ps(load128(src + 16 * i + 48));
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                store128(dst[0] + 4 * i, _mm_castps_si128(r0));
+                store128(dst[1] + 4 * i, _mm_castps_si128(r1));
+                store128(dst[2] + 4 * i, _mm_castps_si128(r2));
+                store128(dst[3] + 4 * i, _mm_castps_si128(r3));
+            }
+        } else if (WORD == 2 && channels == 2) {
+            for (; i + 8 <= n; i += 8) {
+                const __m128i a = load128(src + 4 * i);
+                const __m128i b = load128(src + 4 * i + 16);
+                store128(dst[0] + 2 * i, lowHalves(a, b));
+                store128(dst[1] + 2 * i, highHalves(a, b));
+            }
+        } else if (WORD == 2 && channels == 4) {
+            // Erst Feldpaare (0, 1) und (2, 3) wie 32-Bit-Felder trennen, dann die Paare
+            for (; i + 8 <= n; i += 8) {
+                const __m128 a0 = _mm_castsi128_ps(load128(src + 8 * i));
+                const __m128 a1 = _mm_castsi128_ps(load128(src + 8 * i + 16));
+                const __m128 a2 = _mm_castsi128_ps(load128(src + 8 * i + 32));
+                const __m128 a3 = _mm_castsi128_ps(load128(src + 8 * i + 48));
+                const __m128i p01a = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+                const __m128i p01b = _mm_castps_si128(_mm_shuffle_ps(a2, a3, _MM_SHUFFLE(2, 0, 2, 0)));
+                const __m128i p23a = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+                const __m128i p23b = _mm_castps_si128(_mm_shuffle_ps(a2, a3, _MM_SHUFFLE(3, 1, 3, 1)));
+                store128(dst[0] + 2 * i, lowHalves(p01a, p01b));
+                store128(dst[1] + 2 * i, highHalves(p01a, p01b));
+                store128(dst[2] + 2 * i, lowHalves(p23a, p23b));
+                store128(dst[3] + 2 * i, highHalves(p23a, p23b));
+            }
+        }
+#endif
+        for (; i < n; i++) {
+            for (size_t c = 0; c < channels; c++) {
+                memcpy(static_cast<char *>(out[c]) + i * WORD, src + (i * channels + c) * WORD, WORD);
+            }
+        }
+    }
+
+private:
+
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+    static __m128i load128(const char *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+
+    static void store128(char *p, __m128i x) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), x);
+    }
+
+    /** Byte-Umkehr jedes Worts nur mit SSE2: Wrter zu 16 Bit umordnen, dann die Bytes jedes 16-Bit-Worts tauschen */
+    template <size_t WORD>
+    static __m128i swapWords(__m128i x) {
+        if (WORD == 4) {
+            x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        } else if (WORD == 8) {
+            x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+    }
+
+    /** @return die unteren 16 Bit jedes 32-Bit-Felds von a, dann von b */
+    static __m128i lowHalves(__m128i a, __m128i b) {
+        // Vorzeichenrichtig auf 32 Bit erweitert: packs_epi32 sttigt dann nie
+        return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+    }
+
+    /** @return die oberen 16 Bit jedes 32-Bit-Felds von a, dann von b */
+    static __m128i highHalves(__m128i a, __m128i b) {
+        return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+    }
+#endif
+
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSSE3) || defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+    /** @return Maske fr _mm_shuffle_epi8, die in jedem Wort zu WORD Bytes die Reihenfolge umkehrt */
+    template <size_t WORD>
+    static __m128i swapMask() {
+        alignas(16) int8_t mask[16];
+        for (size_t j = 0; j < 16; j++) {
+            mask[j] = static_cast<int8_t>(j / WORD * WORD + WORD - 1 - j % WORD);
+        }
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(mask));
+    }
+#endif
+
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+    static __m256i load256(const char *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    static void store256(char *p, __m256i x) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), x);
+    }
+#endif
+};
+
+/**
+ * Transformation fr DecodingReadEngine: kehrt in jedem Element die Byte-Reihenfolge jedes Worts zu WORD Bytes um,
+ * z.B. fr big-endian geschriebene Dateien. Auf der Platte und im Cache derselbe Typ T.
+ */
+template <class T, size_t WORD = sizeof(T)>
+class ByteSwapTransform {
+public:
+
+    static_assert(sizeof(T) % WORD == 0, "ByteSwapTransform: T muss aus Wrtern zu WORD Bytes bestehen");
+
+    void operator()(const T *in, T *out, size_t n) const {
+        DecodeKernels::byteSwap<WORD>(in, out, n * (sizeof(T) / WORD));
+    }
+};
+
+/**
+ * Transformation fr DecodingReadEngine: jedes int16_t-Feld von DISK wird zum float-Feld an derselben Stelle in T,
+ * value * scale + offset. DISK besteht also nur aus int16_t (ein Abtastwert oder ein Frame mehrerer Kanle), T aus
+ * ebenso vielen float.
+ *
+ *     struct Frame_t { int16_t channel[4]; };
+ *     struct Samples_t { float channel[4]; };
+ *     DecodingReadEngine<Frame_t, Samples_t, Int16ToFloatTransform<Frame_t, Samples_t>> decoded{disk, {1.0f / 32768, 0.0f, true}};
+ */
+template <class DISK, class T>
+class Int16ToFloatTransform {
+public:
+
+    /**
+     * @param swapBytes true: die Datei hat die andere Byte-Reihenfolge als die Maschine
+     */
+    Int16ToFloatTransform(float scale = 1.0f, float offset = 0.0f, bool swapBytes = false) :
+        scale_(scale), offset_(offset), swapBytes_(swapBytes) {}
+
+    void operator()(const DISK *in, T *out, size_t n) const {
+        DecodeKernels::int16ToFloat(in, out, n * LANES, scale_, offset_, swapBytes_);
+    }
+
+private:
+
+    static constexpr size_t LANES{ sizeof(DISK) / sizeof(int16_t) };
+    static_assert(sizeof(DISK) % sizeof(int16_t) == 0 && sizeof(T) == LANES * sizeof(float),
+        "Int16ToFloatTransform: DISK aus int16_t, T aus ebenso vielen float");
+
+    float scale_;
+    float offset_;
+    bool swapBytes_;
+};
+
+/**
+ * IReadEngine, die Datenstze DISK aus einer anderen Engine liest und mit transform in Elemente T umwandelt, bevor sie
+ * in den Cache kommen. Die Datei enthlt also DISK, der Buffer (CircularBidirectionalFilereaderBuffer<T, ...>) T.
+ * Umgewandelt wird in read, also in fillUpwards bzw. fillDownwards auf dem Fller-Thread, ein ganzer Fill auf einmal
+ * statt Element fr Element nach jedem getNext. Gelesen wird in Stcken von hchstens 64 KiB ber einen
+ * Zwischenpuffer, der fr die Umwandlung noch im Cache der CPU liegt.
+ *
+ *     PreadReadEngine disk{fd};
+ *     DecodingReadEngine<int16_t, float, Int16ToFloatTransform<int16_t, float>> decoded{disk, {1.0f / 32768, 0.0f, true}};
+ *     CircularBidirectionalFilereaderBuffer<float, 65536> buffer{decoded};
+ *
+ * Fertige Transformationen: ByteSwapTransform, Int16ToFloatTransform. Fr eigene stehen die DecodeKernels zur
+ * Verfgung. Wie die darunterliegende Engine nur aus einem Thread verwenden.
+ *
+ * @tparam TRANSFORM void transform(const DISK *in, T *out, size_t n), wandelt n Datenstze um
+ */
+template <class DISK, class T, class TRANSFORM>
+class DecodingReadEngine : public IReadEngine {
+public:
+
+    static_assert(std::is_trivially_copyable<DISK>::value, "DecodingReadEngine: DISK wird direkt aus der Datei gelesen");
+
+    /**
+     * @param engine liest die Datei. Muss lnger leben als diese.
+     * @param transform wandelt die gelesenen Datenstze um
+     */
+    DecodingReadEngine(IReadEngine &engine, TRANSFORM transform = TRANSFORM()) :
+        engine_(engine), transform_(transform), scratch_(CHUNK_LENGTH) {}
+
+    DecodingReadEngine(const DecodingReadEngine &) = delete;
+    DecodingReadEngine &operator=(const DecodingReadEngine &) = delete;
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        assert(elementSize == sizeof(T));
+        (void)elementSize;
+        T *out = static_cast<T *>(dest);
+        size_t done = 0;
+        while (done < count) {
+            const size_t n = std::min(CHUNK_LENGTH, count - done);
+            const size_t nRead = engine_.read(scratch_.data(), sizeof(DISK), n, first + done);
+            transform_(scratch_.data(), out + done, nRead);
+            done += nRead;
+            if (nRead < n) {
+                break;
+            }
+        }
+        return done;
+    }
+
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        (void)elementSize;
+        engine_.prefetch(sizeof(DISK), count, first);
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        (void)elementSize;
+        return engine_.size(sizeof(DISK));
+    }
+
+private:
+
+    /** Datenstze pro Stck: so viele, wie in 64 KiB passen */
+    static constexpr size_t CHUNK_LENGTH{ std::max<size_t>((1u << 16) / sizeof(DISK), 1) };
+
+    IReadEngine &engine_;
+    TRANSFORM transform_;
+    std::vector<DISK> scratch_;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef FILEFOLLOWER_HPP_
+#define FILEFOLLOWER_HPP_
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/**
+ * Beobachtet eine Datei, an die noch geschrieben wird, und meldet dem Buffer im Folgemodus, wenn sie gewachsen ist
+ * (Linux). Ein eigener Thread wartet mit inotify (IN_MODIFY) auf Schreibvorgnge; geht inotify nicht (Limit erreicht,
+ * Netzwerk-Dateisystem), prft er alle pollInterval die Grsse mit stat. Auch mit inotify wird alle pollInterval
+ * geprft, die Verzgerung bis zum Wecken eines wartenden Lesers ist also hchstens pollInterval.
+ *
+ *     FILE *f = fopen("recording.bin", "rb");
+ *     myBufferType buffer{f};
+ *     myBufferType::DefaultListener workerTask{buffer};
+ *     buffer.setFollow(true);
+ *     FileFollower<myBufferType> follower{buffer, "recording.bin"};
+ *     while (running) {
+ *         if (buffer.getNext(element, std::chrono::seconds(1)) ...
+ *     }
+ *     follower.tearDown();
+ *     workerTask.tearDown();
+ *
+ * @tparam BUFFER Buffer mit notifyFileGrown, @see CircularBidirectionalFilereaderBuffer#setFollow
+ */
+template <class BUFFER>
+class FileFollower {
+public:
+
+    /**
+     * @param buffer bekommt #notifyFileGrown. Muss lnger leben als der FileFollower (bis #tearDown).
+     * @param path Pfad der Datei, die der Buffer liest
+     * @param pollInterval so oft wird die Grsse auch ohne inotify-Ereignis geprft
+     */
+    FileFollower(BUFFER &buffer, const char *path, std::chrono::milliseconds pollInterval = std::chrono::milliseconds(100)) :
+        buffer_(buffer), path_(path), pollInterval_(pollInterval),
+        wakeFd_(eventfd(0, EFD_CLOEXEC)), inotifyFd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+        if (inotifyFd_ >= 0 && inotify_add_watch(inotifyFd_, path, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+            close(inotifyFd_);
+            inotifyFd_ = -1;
+        }
+        lastSize_ = fileSize();
+        thread_ = std::thread(&FileFollower::run, this);
+    }
+
+    ~FileFollower() {
+        assert(!thread_.joinable());  // vorher tearDown aufrufen
+        if (inotifyFd_ >= 0) {
+            close(inotifyFd_);
+        }
+        if (wakeFd_ >= 0) {
+            close(wakeFd_);
+        }
+    }
+
+    FileFollower(const FileFollower &) = delete;
+    FileFollower &operator=(const FileFollower &) = delete;
+
+    /** @return false, wenn inotify nicht eingerichtet werden konnte. Dann wird nur alle pollInterval mit stat geprft. */
+    bool usesInotify() const {
+        return inotifyFd_ >= 0;
+    }
+
+    void tearDown() {
+        const uint64_t one = 1;
+        if (write(wakeFd_, &one, sizeof(one)) < 0) {
+            // eventfd kann nur bei berlauf des Zhlers fehlschlagen; der Thread wacht dann sptestens nach pollInterval auf
+        }
+        thread_.join();
+    }
+
+private:
+
+    /** @return Grsse der Datei in Bytes, -1 wenn stat fehlschlgt */
+    long long fileSize() const {
+        struct stat st;
+        return stat(path_.c_str(), &st) == 0 ? static_cast<long long>(st.st_size) : -1;
+    }
+
+    void run() {
+        // Was vor dem Start geschrieben wurde, hat vielleicht noch niemand gemeldet
+        buffer_.notifyFileGrown();
+        struct pollfd fds[2];
+        fds[0].fd = wakeFd_;
+        fds[0].events = POLLIN;
+        fds[1].fd = inotifyFd_;  // -1 wird von poll ignoriert
+        fds[1].events = POLLIN;
+        while (true) {
+            const int n = poll(fds, 2, static_cast<int>(pollInterval_.count()));
+            if (n > 0 && (fds[0].revents & POLLIN) != 0) {
+                break;
+            }
+            if (n > 0 && (fds[1].revents & POLLIN) != 0) {
+                char events[4096];
+                while (read(inotifyFd_, events, sizeof(events)) > 0) {
+                    // nur leeren, welches Ereignis es war, ist egal
+                }
+            }
+            const long long size = fileSize();
+            if (size > lastSize_) {
+                lastSize_ = size;
+                buffer_.notifyFileGrown();
+            } else if (size >= 0) {
+                lastSize_ = size;  // z.B. abgeschnitten und neu geschrieben
+            }
+        }
+    }
+
+    BUFFER &buffer_;
+    const std::string path_;
+    const std::chrono::milliseconds pollInterval_;
+    const int wakeFd_;
+    int inotifyFd_;
+    long long lastSize_{0};
+    std::thread thread_;
+};
+
+#endif
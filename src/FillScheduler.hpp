@@ -0,0 +1,221 @@
+
+#ifndef FILLSCHEDULER_HPP_
+#define FILLSCHEDULER_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Gemeinsamer Fller fr viele Buffer. Statt einem Thread pro DefaultListener arbeitet eine feste Anzahl Worker-Threads
+ * die Fill-Anforderungen aller angemeldeten Buffer ab.
+ *
+ * Ein Buffer wird ber einen FillScheduler::Listener angeschlossen, der wie der DefaultListener das
+ * IBackgroundTaskListener des Buffers implementiert. Wiederholte Anforderungen fr denselben Buffer und dieselbe Richtung
+ * werden zusammengefasst, bis der Fill luft. Es luft nie mehr als ein Fill pro Buffer gleichzeitig (der LOCK_FREE-Betrieb
+ * erlaubt nur einen Fller). Von den wartenden Anforderungen wird die dringendste zuerst bedient: die mit den wenigsten
+ * Elementen, die in der angeforderten Richtung noch im Cache liegen (fillLevel des Buffers).
+ *
+ *     FillScheduler scheduler{4};
+ *     FillScheduler::Listener<myBufferType> listener{scheduler, buffer};
+ *     ...
+ *     listener.tearDown();
+ *     scheduler.tearDown();
+ */
+class FillScheduler {
+public:
+
+    /**
+     * Beim FillScheduler angemeldeter Buffer, unabhngig von dessen Typ. @see Listener
+     */
+    class Client {
+    public:
+
+        virtual ~Client() {}
+
+        /** Ruft fillUpwards bzw. fillDownwards des Buffers auf */
+        virtual void fill(bool up) = 0;
+
+        /** @return Anzahl Elemente, die in Richtung up noch im Cache liegen. Je kleiner, desto dringender der Fill. */
+        virtual size_t fillLevel(bool up) const = 0;
+
+    private:
+
+        friend class FillScheduler;
+
+        /** Angeforderte, noch nicht gestartete Fills. [0]: abwrts, [1]: aufwrts. Geschtzt durch FillScheduler::mutex_ */
+        bool requested_[2]{false, false};
+        /** In FillScheduler::queue_ eingetragen */
+        bool queued_{false};
+        /** Ein Worker fllt gerade */
+        bool busy_{false};
+    };
+
+    /**
+     * IBackgroundTaskListener fr einen Buffer, der seine Fills dem FillScheduler bergibt.
+     * @tparam BUFFER Buffer mit setListener, fillUpwards, fillDownwards und fillLevel, z.B. CircularBidirectionalFilereaderBuffer
+     */
+    template <class BUFFER>
+    class Listener : public BUFFER::IBackgroundTaskListener, public Client {
+    public:
+
+        Listener(FillScheduler &scheduler, BUFFER &theBuffer) : scheduler_(scheduler), theBuffer_(theBuffer) {
+            theBuffer_.setListener(this);
+        }
+
+        virtual ~Listener() {
+            tearDown();
+        }
+
+        virtual void requestFill(bool up) override {
+            scheduler_.requestFill(*this, up);
+        }
+
+        /** Meldet den Buffer ab. Wartet, bis ein laufender Fill fertig ist; noch nicht gestartete werden verworfen. */
+        void tearDown() {
+            scheduler_.detach(*this);
+        }
+
+    private:
+
+        virtual void fill(bool up) override {
+            if (up) {
+                theBuffer_.fillUpwards();
+            } else {
+                theBuffer_.fillDownwards();
+            }
+        }
+
+        virtual size_t fillLevel(bool up) const override {
+            return theBuffer_.fillLevel(up);
+        }
+
+        FillScheduler &scheduler_;
+        BUFFER &theBuffer_;
+    };
+
+    /**
+     * @param nWorkers Anzahl Worker-Threads. 0: so viele, wie die Hardware gleichzeitig ausfhren kann.
+     */
+    FillScheduler(unsigned int nWorkers = 0) {
+        if (nWorkers == 0) {
+            nWorkers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned int i = 0; i < nWorkers; i++) {
+            workers_.emplace_back(&FillScheduler::run, this);
+        }
+    }
+
+    ~FillScheduler() {
+        assert(workers_.empty());  // vorher tearDown aufrufen
+    }
+
+    FillScheduler(const FillScheduler &) = delete;
+    FillScheduler &operator=(const FillScheduler &) = delete;
+
+    /** Beendet die Worker-Threads. Laufende Fills werden noch fertig gemacht, wartende verworfen. */
+    void tearDown() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            keepRunning_ = false;
+        }
+        workAvailable_.notify_all();
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+    }
+
+private:
+
+    void requestFill(Client &client, bool up) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (client.requested_[up]) {
+                return;  // schon angefordert, der Fill ist noch nicht gestartet
+            }
+            client.requested_[up] = true;
+            if (!client.queued_) {
+                client.queued_ = true;
+                queue_.push_back(&client);
+            }
+            if (client.busy_) {
+                return;  // der Worker, der gerade fllt, nimmt die Anforderung danach mit
+            }
+        }
+        workAvailable_.notify_one();
+    }
+
+    void detach(Client &client) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if (client.queued_) {
+            queue_.erase(std::find(queue_.begin(), queue_.end(), &client));
+            client.queued_ = false;
+        }
+        client.requested_[0] = client.requested_[1] = false;
+        fillDone_.wait(lock, [&client] { return !client.busy_; });
+    }
+
+    /**
+     * Sucht die dringendste Anforderung eines Buffers, der nicht gerade gefllt wird.
+     * @return false, wenn es keine gibt
+     */
+    bool pick(Client *&client, bool &up) const {
+        size_t mostUrgent{0};
+        client = nullptr;
+        for (Client *candidate : queue_) {
+            if (candidate->busy_) {
+                continue;
+            }
+            for (int direction = 0; direction < 2; direction++) {
+                if (candidate->requested_[direction]) {
+                    const size_t level = candidate->fillLevel(direction != 0);
+                    if (client == nullptr || level < mostUrgent) {
+                        client = candidate;
+                        up = direction != 0;
+                        mostUrgent = level;
+                    }
+                }
+            }
+        }
+        return client != nullptr;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true) {
+            Client *client{nullptr};
+            bool up{false};
+            workAvailable_.wait(lock, [&] { return !keepRunning_ || pick(client, up); });
+            if (!keepRunning_) {
+                break;
+            }
+            client->requested_[up] = false;
+            if (!client->requested_[!up]) {
+                queue_.erase(std::find(queue_.begin(), queue_.end(), client));
+                client->queued_ = false;
+            }
+            client->busy_ = true;
+            lock.unlock();
+            client->fill(up);
+            lock.lock();
+            client->busy_ = false;
+            fillDone_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    /** Neue Anforderung eingetragen oder tearDown */
+    std::condition_variable workAvailable_;
+    /** Ein Fill ist fertig, @see detach */
+    std::condition_variable fillDone_;
+    /** Buffer mit angeforderten Fills, in der Reihenfolge der ersten Anforderung */
+    std::vector<Client *> queue_;
+    bool keepRunning_{true};
+    std::vector<std::thread> workers_;  // zuletzt, damit run() nur initialisierte Member sieht
+};
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef KEYINDEX_HPP_
+#define KEYINDEX_HPP_
+
+#include <stdio.h> // FILE
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * Dnner Index fr CircularBidirectionalFilereaderBuffer#seekToKey in einer nach einem Schlssel sortierten Datei:
+ * der Schlssel des ersten Elements jedes Blocks von blockLength Elementen. Aufgebaut wird er nebenbei: jede Suche
+ * liest nur die Blockschlssel, die sie braucht (O(log n) Lesevorgnge), und merkt sie sich. Mit #save und #load
+ * kann er neben der Datei gespeichert werden.
+ *
+ *     auto timestamp = [](const Record_t &r) { return r.timestamp; };
+ *     PreadReadEngine indexDisk{fd};
+ *     KeyIndex<Record_t, uint64_t, decltype(timestamp)> index{indexDisk, timestamp, 256};
+ *     index.load("recording.idx");
+ *     index.seek(buffer, t);  // ein Lesevorgang fr den Cache, wenn die Blockschlssel bekannt sind
+ *
+ * blockLength hchstens ein Viertel der Cache-Lnge: dann liest #seek ausser den Blockschlsseln nur noch den Cache
+ * an der neuen Position. Nur aus einem Thread verwenden (dem Leser des Buffers).
+ *
+ * @tparam KEY Schlssel, mit operator<. Fr #save und #load trivial kopierbar.
+ * @tparam EXTRACTOR KEY extractor(const T &)
+ */
+template <class T, class KEY, class EXTRACTOR>
+class KeyIndex {
+public:
+
+    /**
+     * @param engine liest die Datei. Eine eigene, nicht die des Buffers: dessen Fller benutzt sie gleichzeitig.
+     *        Muss lnger leben als diese und ihre Grsse kennen.
+     * @param extractor liefert den Schlssel eines Elements
+     * @param blockLength Elemente pro Indexeintrag
+     */
+    KeyIndex(IReadEngine &engine, EXTRACTOR extractor, size_t blockLength = 256) :
+        engine_(engine), extractor_(extractor), blockLength_(blockLength) {
+        assert(blockLength > 0);
+        const size_t n = engine_.size(sizeof(T));
+        nElements_ = n == std::numeric_limits<size_t>::max() ? 0 : n;
+        const size_t nBlocks = (nElements_ + blockLength_ - 1) / blockLength_;
+        keys_.resize(nBlocks);
+        known_.resize(nBlocks, 0);
+    }
+
+    KeyIndex(const KeyIndex &) = delete;
+    KeyIndex &operator=(const KeyIndex &) = delete;
+
+    /** @return Elemente der Datei beim Erstellen des Index */
+    size_t size() const {
+        return nElements_;
+    }
+
+    /** @return bisher fr den Index gelesene Elemente */
+    size_t reads() const {
+        return reads_;
+    }
+
+    /**
+     * @return Bereich [first, last], in dem das erste Element mit Schlssel >= key liegt (last heisst auch: keines).
+     *         Hchstens blockLength Elemente.
+     */
+    std::pair<size_t, size_t> bracket(const KEY &key) {
+        // Gesucht: der letzte Block, dessen erstes Element kleiner als key ist
+        size_t lo = 0;
+        size_t hi = keys_.size();
+        while (lo < hi) {
+            const size_t middle = lo + (hi - lo) / 2;
+            if (blockKey(middle) < key) {
+                lo = middle + 1;
+            } else {
+                hi = middle;
+            }
+        }
+        if (lo == 0) {
+            return { 0, 0 };
+        }
+        const size_t block = lo - 1;
+        return { block * blockLength_ + 1, std::min(nElements_, (block + 1) * blockLength_) };
+    }
+
+    /**
+     * CircularBidirectionalFilereaderBuffer#seekToKey im Bereich von #bracket.
+     * @return @see CircularBidirectionalFilereaderBuffer#seekToKey
+     */
+    template <class BUFFER>
+    typename BUFFER::CacheState_t seek(BUFFER &buffer, const KEY &key) {
+        const std::pair<size_t, size_t> range = bracket(key);
+        return buffer.seekToKey(key, extractor_, range.first, range.second);
+    }
+
+    /** Liest alle noch fehlenden Blockschlssel, z.B. vor #save */
+    void build() {
+        for (size_t block = 0; block < keys_.size(); block++) {
+            blockKey(block);
+        }
+    }
+
+    /**
+     * Speichert die bekannten Blockschlssel.
+     * @return false, wenn die Datei nicht geschrieben werden konnte
+     */
+    bool save(const char *path) const {
+        static_assert(std::is_trivially_copyable<KEY>::value, "KeyIndex::save braucht einen trivial kopierbaren Schlssel");
+        FILE *file = fopen(path, "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        const Header_t header{ MAGIC, VERSION, static_cast<uint32_t>(sizeof(T)), static_cast<uint32_t>(sizeof(KEY)), blockLength_, nElements_ };
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(known_.data(), 1, known_.size(), file) == known_.size()
+            && fwrite(keys_.data(), sizeof(KEY), keys_.size(), file) == keys_.size();
+        ok = fclose(file) == 0 && ok;
+        return ok;
+    }
+
+    /**
+     * bernimmt die mit #save gespeicherten Blockschlssel, wenn sie zu dieser Datei passen (gleiche Lnge,
+     * Element- und Blockgrsse).
+     * @return false, wenn die Datei fehlt oder nicht passt. Der Index bleibt dann, wie er war.
+     */
+    bool load(const char *path) {
+        static_assert(std::is_trivially_copyable<KEY>::value, "KeyIndex::load braucht einen trivial kopierbaren Schlssel");
+        FILE *file = fopen(path, "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        Header_t header;
+        std::vector<uint8_t> known(known_.size());
+        std::vector<KEY> keys(keys_.size());
+        const bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == MAGIC && header.version == VERSION
+            && header.elementSize == sizeof(T) && header.keySize == sizeof(KEY) && header.blockLength == blockLength_
+            && header.nElements == nElements_
+            && fread(known.data(), 1, known.size(), file) == known.size()
+            && fread(keys.data(), sizeof(KEY), keys.size(), file) == keys.size();
+        fclose(file);
+        if (ok) {
+            known_.swap(known);
+            keys_.swap(keys);
+        }
+        return ok;
+    }
+
+private:
+
+    /** "CBFK" */
+    static constexpr uint32_t MAGIC{ 0x4B464243u };
+    static constexpr uint32_t VERSION{ 1u };
+
+    struct Header_t {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t elementSize;
+        uint32_t keySize;
+        uint64_t blockLength;
+        uint64_t nElements;
+    };
+
+    /** @return Schlssel des ersten Elements von block. Liest ihn, wenn er noch nicht bekannt ist. */
+    const KEY &blockKey(size_t block) {
+        if (known_[block] == 0) {
+            T element;
+            if (engine_.read(&element, sizeof(T), 1, block * blockLength_) == 1) {
+                keys_[block] = extractor_(element);
+                known_[block] = 1;
+            }
+            reads_++;
+        }
+        return keys_[block];
+    }
+
+    IReadEngine &engine_;
+    EXTRACTOR extractor_;
+    const size_t blockLength_;
+    size_t nElements_;
+    std::vector<KEY> keys_;
+    /** 1: keys_ fr diesen Block gelesen. uint8_t statt bool, damit es sich speichern lsst. */
+    std::vector<uint8_t> known_;
+    size_t reads_{0};
+};
+
+#endif
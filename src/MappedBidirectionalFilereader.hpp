@@ -0,0 +1,260 @@
+
+#ifndef MAPPEDBIDIRECTIONALFILEREADER_HPP_
+#define MAPPEDBIDIRECTIONALFILEREADER_HPP_
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * Variante von CircularBidirectionalFilereaderBuffer fr POSIX-Systeme, die die Datei in den Speicher mappt, statt sie
+ * mit fread in data_ zu kopieren. Schnittstelle und CacheState_t wie beim CircularBidirectionalFilereaderBuffer.
+ *
+ * Der "Cache" ist hier ein Fenster von DATA_TUPLES_CHACHE_LENGTH Elementen im Mapping. Statt zu kopieren, sorgen
+ * #fillUpwards und #fillDownwards mit madvise dafr, dass das nchste Viertel in den Page-Cache geladen (MADV_WILLNEED)
+ * und das Viertel, das aus dem Fenster fllt, freigegeben wird (MADV_COLD, wo nicht vorhanden MADV_DONTNEED).
+ * Die Residenz im Page-Cache folgt damit dem Lesezeiger gleich wie die Viertel beim CircularBidirectionalFilereaderBuffer.
+ *
+ * Es gibt einen Leser-Thread und einen Fller-Thread. Die Fenstergrenzen werden ber Atomics ausgetauscht.
+ * @tparam T Typ der Datenelemente
+ * @tparam DATA_TUPLES_CHACHE_LENGTH Grsse des Fensters in Elementen. Muss eine Zweierpotenz sein
+ */
+template <class T, unsigned int DATA_TUPLES_CHACHE_LENGTH>
+class MappedBidirectionalFilereader {
+
+    public:
+
+        typedef typename CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH>::CacheState_t CacheState_t;
+        typedef typename CircularBidirectionalFilereaderBuffer<T, DATA_TUPLES_CHACHE_LENGTH>::IBackgroundTaskListener IBackgroundTaskListener;
+
+        /**
+         * Diese Implementierung von IBackgroundTaskListener kann standardmssig verwendet werden.
+         */
+        class DefaultListener : public BackgroundFillThread<MappedBidirectionalFilereader, IBackgroundTaskListener> {
+        public:
+
+            DefaultListener(MappedBidirectionalFilereader &theBuffer) :
+                BackgroundFillThread<MappedBidirectionalFilereader, IBackgroundTaskListener>(theBuffer) {
+            }
+        };
+
+        /**
+         * @param fd zum Lesen geffnete Datei. Bleibt im Besitz des Aufrufers; das Mapping bleibt auch nach close gltig.
+         * @throws std::system_error wenn mmap fehlschlgt
+         */
+        MappedBidirectionalFilereader(int fd) {
+            static_assert(DATA_TUPLES_CHACHE_LENGTH >= 4 && !(DATA_TUPLES_CHACHE_LENGTH & (DATA_TUPLES_CHACHE_LENGTH - 1)));  // Power of two
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(T))) {
+                mappedBytes_ = static_cast<size_t>(st.st_size);
+                void *p = mmap(nullptr, mappedBytes_, PROT_READ, MAP_SHARED, fd, 0);
+                if (p == MAP_FAILED) {
+                    throw std::system_error(errno, std::generic_category(), "mmap");
+                }
+                data_ = static_cast<const T *>(p);
+                nElements_ = mappedBytes_ / sizeof(T);
+                // Die Reihenfolge bestimmen die Fills, nicht das Readahead des Kernels
+                madvise(p, mappedBytes_, MADV_RANDOM);
+            }
+            initialize();
+        }
+
+        ~MappedBidirectionalFilereader() {
+            if (data_ != nullptr) {
+                munmap(const_cast<T *>(data_), mappedBytes_);
+            }
+        }
+
+        MappedBidirectionalFilereader(const MappedBidirectionalFilereader &) = delete;
+        MappedBidirectionalFilereader &operator=(const MappedBidirectionalFilereader &) = delete;
+
+        /**
+        * Setzen des Listeners. Muss ausgefhrt werden bevor #getNext oder #getPrev aufgerufen werden.
+        */
+        void setListener(IBackgroundTaskListener* l) {
+            listener_ = l;
+        }
+
+        /** Anzahl Elemente, die in Richtung up hinter der aktuellen Position noch im Fenster liegen. @see CircularBidirectionalFilereaderBuffer#fillLevel */
+        size_t fillLevel(bool up) const {
+            const size_t position = position_.load(std::memory_order_relaxed);
+            if (up) {
+                const size_t top = top_.load(std::memory_order_relaxed);
+                return top > position ? top - position - 1 : 0;
+            }
+            const size_t bottom = bottom_.load(std::memory_order_relaxed);
+            return position > bottom ? position - bottom : 0;
+        }
+
+        /**
+         * Setzt den Lesezeiger an den Anfang der Datei. Das Fenster umfasst die erste Hlfte, die vorgeladen wird.
+         * Darf nicht gleichzeitig mit einem Fill laufen.
+         */
+        void initialize() {
+            position_.store(0, std::memory_order_relaxed);
+            bottom_.store(0, std::memory_order_relaxed);
+            const size_t top = std::min(static_cast<size_t>(DATA_TUPLES_CHACHE_LENGTH / 2), nElements_);
+            advise(0, top, MADV_WILLNEED);
+            top_.store(top, std::memory_order_release);
+        }
+
+        /**
+         * Rckgabe des Elements an der aktuellen Position
+         * @pre Datei nicht leer
+         */
+        void getCurrent(T& ele) const {
+            ele = data_[position_.load(std::memory_order_relaxed)];
+        }
+
+        /**
+        * Rckgabe des nchsten Werts
+        * @param[out] ele Der Wert
+        * @return @see CacheState_t. ALMOST_EMPTY bedeutet hier, dass das Fenster erschpft ist; der Wert ist trotzdem
+        *         gltig, kommt aber womglich direkt von der Platte. CACHE_OVERFLOW gibt es nicht. END_OF_FILE auch, wenn
+        *         die Position schon auf dem letzten Element steht; dann bleibt sie dort und ele ist das letzte Element
+        *         (wie beim CircularBidirectionalFilereaderBuffer). Bei leerer Datei bleibt ele ungesetzt.
+        * @pre #setListener ausgefhrt.
+        */
+        CacheState_t getNext(T& ele) {
+            const size_t position = position_.load(std::memory_order_relaxed) + 1;
+            if (position >= nElements_) {
+                if (nElements_ > 0) {
+                    ele = data_[position - 1];
+                }
+                return CacheState_t::END_OF_FILE;
+            }
+            position_.store(position, std::memory_order_relaxed);
+            ele = data_[position];
+            const size_t top = top_.load(std::memory_order_acquire);
+            CacheState_t retVal{ CacheState_t::OK };
+            if (position == nElements_ - 1) {
+                retVal = CacheState_t::END_OF_FILE;
+            } else if (position + 1 >= top) {
+                retVal = CacheState_t::ALMOST_EMPTY;
+            }
+            if (top < nElements_ && top <= position + DATA_TUPLES_CHACHE_LENGTH / 4) {
+                listener_->requestFill(true);
+            }
+            return retVal;
+        }
+
+        /**
+        * Rckgabe des vorherigen Werts
+        * @param[out] ele Der Wert
+        * @return @see getNext
+        */
+        CacheState_t getPrev(T& ele) {
+            const size_t position = position_.load(std::memory_order_relaxed);
+            if (position == 0) {
+                if (nElements_ > 0) {
+                    ele = data_[0];
+                }
+                return CacheState_t::END_OF_FILE;
+            }
+            position_.store(position - 1, std::memory_order_relaxed);
+            ele = data_[position - 1];
+            const size_t bottom = bottom_.load(std::memory_order_acquire);
+            CacheState_t retVal{ CacheState_t::OK };
+            if (position - 1 == 0) {
+                retVal = CacheState_t::END_OF_FILE;
+            } else if (position - 1 <= bottom) {
+                retVal = CacheState_t::ALMOST_EMPTY;
+            }
+            if (bottom > 0 && position - 1 < bottom + DATA_TUPLES_CHACHE_LENGTH / 4) {
+                listener_->requestFill(false);
+            }
+            return retVal;
+        }
+
+        /** Schiebt das Fenster um einen Viertel nach oben: nchstes Viertel vorladen, unterstes freigeben. */
+        void fillUpwards() {
+            const size_t top = top_.load(std::memory_order_relaxed);
+            const size_t bottom = bottom_.load(std::memory_order_relaxed);
+            // doppelte fillUpwards - Aufrufe abfangen
+            if (top < nElements_ && top <= position_.load(std::memory_order_relaxed) + DATA_TUPLES_CHACHE_LENGTH / 4) {
+                const size_t newTop = std::min(top + DATA_TUPLES_CHACHE_LENGTH / 4, nElements_);
+                advise(top, newTop, MADV_WILLNEED);
+                const size_t newBottom = newTop > DATA_TUPLES_CHACHE_LENGTH ? newTop - DATA_TUPLES_CHACHE_LENGTH : 0;
+                if (newBottom > bottom) {
+                    release(bottom, newBottom);
+                }
+                bottom_.store(newBottom, std::memory_order_release);
+                top_.store(newTop, std::memory_order_release);
+            }
+        }
+
+        /** Schiebt das Fenster um einen Viertel nach unten. Gegenstck zu #fillUpwards. */
+        void fillDownwards() {
+            const size_t top = top_.load(std::memory_order_relaxed);
+            const size_t bottom = bottom_.load(std::memory_order_relaxed);
+            // doppelte fillDownwards - Aufrufe abfangen
+            if (bottom > 0 && position_.load(std::memory_order_relaxed) < bottom + DATA_TUPLES_CHACHE_LENGTH / 4) {
+                const size_t newBottom = bottom - std::min(static_cast<size_t>(DATA_TUPLES_CHACHE_LENGTH / 4), bottom);
+                advise(newBottom, bottom, MADV_WILLNEED);
+                const size_t newTop = std::min(newBottom + DATA_TUPLES_CHACHE_LENGTH, top);
+                if (newTop < top) {
+                    release(newTop, top);
+                }
+                top_.store(newTop, std::memory_order_release);
+                bottom_.store(newBottom, std::memory_order_release);
+            }
+        }
+
+        /** Anzahl Elemente in der Datei */
+        size_t size() const {
+            return nElements_;
+        }
+
+     private:
+
+        /** madvise fr die Elemente [first, last), auf ganze Seiten erweitert. */
+        void advise(size_t first, size_t last, int advice) const {
+            if (first >= last) {
+                return;
+            }
+            const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            const size_t begin = first * sizeof(T) / page * page;
+            const size_t end = last * sizeof(T);
+            madvise(const_cast<char *>(reinterpret_cast<const char *>(data_)) + begin, end - begin, advice);
+        }
+
+        /**
+         * Gibt die Elemente [first, last) frei. Nur ganze Seiten, damit nichts vom Fenster mitgeht.
+         * MADV_COLD lsst die Seiten im Page-Cache, gibt sie aber zuerst wieder her; ltere Kernel kennen nur MADV_DONTNEED.
+         */
+        void release(size_t first, size_t last) const {
+            const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            const size_t begin = (first * sizeof(T) + page - 1) / page * page;
+            const size_t end = last * sizeof(T) / page * page;
+            if (begin >= end) {
+                return;
+            }
+            char *p = const_cast<char *>(reinterpret_cast<const char *>(data_)) + begin;
+#ifdef MADV_COLD
+            if (madvise(p, end - begin, MADV_COLD) == 0 || errno != EINVAL) {
+                return;
+            }
+#endif
+            madvise(p, end - begin, MADV_DONTNEED);
+        }
+
+        const T *data_{nullptr};
+        size_t mappedBytes_{0};
+        /** Anzahl Elemente in der Datei */
+        size_t nElements_{0};
+        IBackgroundTaskListener *listener_{nullptr};
+        /** Lesezeiger (Element-Index in der Datei). Wird nur vom Leser geschrieben. */
+        std::atomic<size_t> position_;
+        /** 1 hher als der oberste Element-Index im Fenster. Wird nur vom Fller geschrieben. */
+        std::atomic<size_t> top_;
+        /** Niedrigster Element-Index im Fenster. Wird nur vom Fller geschrieben. */
+        std::atomic<size_t> bottom_;
+};
+
+#endif
@@ -0,0 +1,448 @@
+#ifndef MINMAXPYRAMID_HPP_
+#define MINMAXPYRAMID_HPP_
+
+#include <stdio.h> // FILE
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * Eintrag einer Stufe der Pyramide: Minimum, Maximum und Mittelwert der Werte von factor^level Elementen der Rohdatei
+ * (im letzten Eintrag einer Stufe knnen es weniger sein).
+ */
+template <class V>
+struct PyramidEntry_t {
+    V min;
+    V max;
+    double mean;
+};
+
+/**
+ * Dateiformat der Min/Max/Mittelwert-Pyramide, einer Begleitdatei zu einer Rohdatei, z.B. fr eine bersicht, die
+ * die ganze Datei auf einige tausend Pixel verkleinert zeigt.
+ *
+ * Aufbau (Zahlen und Eintrge in der Byte-Reihenfolge und Ausrichtung der Maschine):
+ *
+ *     Header_t | Stufe 1 | Stufe 2 | ... | Stufe levels
+ *
+ * Stufe L enthlt ceil(nElements / factor^L) Eintrge PyramidEntry_t; Eintrag i fasst die Elemente i * factor^L bis
+ * (i + 1) * factor^L - 1 zusammen. Die oberste Stufe hat genau einen Eintrag, Stufe 0 ist die Rohdatei selbst.
+ * Gebaut wird mit PyramidBuilder, aufsteigend; builtElements im Header sagt, wie weit. Gelesen wird jede Stufe mit
+ * einer PyramidReadEngine, also mit einem ganz normalen Buffer.
+ */
+class PyramidFormat {
+public:
+
+    /** "CBFP" */
+    static constexpr uint32_t MAGIC{ 0x50464243u };
+    static constexpr uint32_t VERSION{ 1u };
+
+    struct Header_t {
+        uint32_t magic;
+        uint32_t version;
+        /** Elemente pro Eintrag der Stufe 1, Eintrge pro Eintrag der nchsten Stufe */
+        uint32_t factor;
+        /** sizeof(PyramidEntry_t<V>) */
+        uint32_t entrySize;
+        /** Elemente der Rohdatei */
+        uint64_t nElements;
+        /** So viele Elemente der Rohdatei sind schon eingetragen. Gleich nElements: fertig. */
+        uint64_t builtElements;
+    };
+
+    /** @return Anzahl Stufen ber der Rohdatei, mindestens 1 */
+    static unsigned int levels(uint64_t nElements, uint64_t factor) {
+        unsigned int levels = 1;
+        for (uint64_t span = factor; span < nElements; span *= factor) {
+            levels++;
+        }
+        return levels;
+    }
+
+    /** @return Elemente der Rohdatei pro Eintrag der Stufe level */
+    static uint64_t span(unsigned int level, uint64_t factor) {
+        uint64_t span = 1;
+        for (unsigned int l = 0; l < level; l++) {
+            span *= factor;
+        }
+        return span;
+    }
+
+    /** @return Anzahl vollstndiger Eintrge der Stufe level, wenn builtElements Elemente eingetragen sind */
+    static uint64_t entries(const Header_t &header, unsigned int level, uint64_t builtElements) {
+        const uint64_t span = PyramidFormat::span(level, header.factor);
+        return builtElements >= header.nElements ? (header.nElements + span - 1) / span : builtElements / span;
+    }
+
+    /** @return Byte-Offset der Stufe level in der Datei */
+    static uint64_t levelOffset(const Header_t &header, unsigned int level) {
+        uint64_t offset = sizeof(Header_t);
+        for (unsigned int l = 1; l < level; l++) {
+            offset += entries(header, l, header.nElements) * header.entrySize;
+        }
+        return offset;
+    }
+
+    /**
+     * @return die grbste Stufe, die fr elements Elemente noch mindestens minEntries Eintrge hat, z.B. bei der
+     *         Breite des Bildschirms in Pixeln. 0 heisst: die Rohdatei selbst (oder eine StridedReadEngine darauf).
+     */
+    static unsigned int levelFor(uint64_t elements, uint64_t minEntries, uint64_t factor, unsigned int levels) {
+        unsigned int level = 0;
+        for (uint64_t span = factor; level < levels && elements / span >= minEntries; span *= factor) {
+            level++;
+        }
+        return level;
+    }
+};
+
+/**
+ * Baut die Begleitdatei im PyramidFormat zu einer Rohdatei aus Elementen T, in einem eigenen Thread und in einem
+ * einzigen Durchgang: alle Stufen werden gleichzeitig nachgefhrt. Nach jeweils chunkLength Elementen werden die
+ * neuen Eintrge geschrieben und danach builtElements im Header; ein Leser kann also schon die fertigen Eintrge
+ * lesen, whrend der Rest noch gebaut wird. Ist die Begleitdatei fr eine Rohdatei dieser Lnge schon fertig, wird
+ * sie nicht neu gebaut.
+ *
+ *     StdioReadEngine source{fopen("recording.bin", "rb")};
+ *     PyramidBuilder<myDataType, double> builder{source, "recording.pyr", 16, 1u << 16, [](const myDataType &e) { return e.value; }};
+ *     builder.waitForCompletion(std::chrono::seconds(10));
+ *     ...
+ *     builder.tearDown();
+ *
+ * @tparam T Element der Rohdatei
+ * @tparam V Wert, ber den Minimum, Maximum und Mittelwert gebildet werden
+ */
+template <class T, class V = T>
+class PyramidBuilder {
+public:
+
+    typedef PyramidEntry_t<V> Entry_t;
+
+    /**
+     * @param source liest die Rohdatei. Wird nur vom Thread des Builders benutzt und muss bis #tearDown leben.
+     *        Muss ihre Grsse kennen.
+     * @param sidecarPath Begleitdatei
+     * @param factor Elemente pro Eintrag der Stufe 1 und Eintrge pro Eintrag der nchsten Stufe, mindestens 2
+     * @param chunkLength so viele Elemente werden auf einmal gelesen und eingetragen
+     * @param value Wert eines Elements, z.B. ein Feld des Records. Standard: static_cast<V>(element)
+     */
+    PyramidBuilder(IReadEngine &source, const char *sidecarPath, size_t factor = 16, size_t chunkLength = 1u << 16,
+        V (*value)(const T &) = &PyramidBuilder::castValue) :
+        source_(source), chunkLength_(chunkLength), value_(value) {
+        assert(factor >= 2 && chunkLength > 0);
+        const size_t n = source_.size(sizeof(T));
+        header_ = PyramidFormat::Header_t{ PyramidFormat::MAGIC, PyramidFormat::VERSION, static_cast<uint32_t>(factor),
+            static_cast<uint32_t>(sizeof(Entry_t)), n, 0 };
+        if (n == std::numeric_limits<size_t>::max()) {
+            return;  // ohne Lnge kein Platz fr die Stufen
+        }
+        levels_ = PyramidFormat::levels(header_.nElements, factor);
+        FILE *existing = fopen(sidecarPath, "rb");
+        if (existing != nullptr) {
+            PyramidFormat::Header_t old;
+            const bool done = fread(&old, sizeof(old), 1, existing) == 1 && old.magic == header_.magic && old.version == header_.version
+                && old.factor == header_.factor && old.entrySize == header_.entrySize && old.nElements == header_.nElements
+                && old.builtElements == old.nElements;
+            fclose(existing);
+            if (done) {
+                builtElements_.store(header_.nElements, std::memory_order_release);
+                valid_ = true;
+                return;
+            }
+        }
+        file_ = fopen(sidecarPath, "w+b");
+        if (file_ == nullptr || fwrite(&header_, sizeof(header_), 1, file_) != 1 || fflush(file_) != 0) {
+            return;
+        }
+        valid_ = true;
+        accumulators_.resize(levels_ + 1);
+        pending_.resize(levels_ + 1);
+        written_.resize(levels_ + 1, 0);
+        finished_ = false;
+        thread_ = std::thread(&PyramidBuilder::run, this);
+    }
+
+    ~PyramidBuilder() {
+        assert(!thread_.joinable());  // vorher tearDown aufrufen
+        if (file_ != nullptr) {
+            fclose(file_);
+        }
+    }
+
+    PyramidBuilder(const PyramidBuilder &) = delete;
+    PyramidBuilder &operator=(const PyramidBuilder &) = delete;
+
+    /** @return false, wenn die Begleitdatei nicht geschrieben werden kann oder die Lnge der Rohdatei unbekannt ist */
+    bool isValid() const {
+        return valid_.load(std::memory_order_acquire);
+    }
+
+    /** @return Anzahl Stufen ber der Rohdatei */
+    unsigned int levels() const {
+        return levels_;
+    }
+
+    /** @return so viele Elemente der Rohdatei sind eingetragen und in der Begleitdatei lesbar */
+    uint64_t builtElements() const {
+        return builtElements_.load(std::memory_order_acquire);
+    }
+
+    bool isComplete() const {
+        return isValid() && builtElements() == header_.nElements;
+    }
+
+    /** Wartet, bis der Durchgang fertig (oder gescheitert) ist, hchstens timeout lang. @return #isComplete */
+    template <class Rep, class Period>
+    bool waitForCompletion(const std::chrono::duration<Rep, Period> &timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finishedCondition_.wait_for(lock, timeout, [this] { return finished_; });
+        return isComplete();
+    }
+
+    /** Bricht einen laufenden Durchgang ab. Die Begleitdatei bleibt dann unvollstndig und wird beim nchsten Mal neu gebaut. */
+    void tearDown() {
+        stop_.store(true, std::memory_order_relaxed);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+
+    /** Angefangener Eintrag einer Stufe */
+    struct Accumulator_t {
+        V min;
+        V max;
+        double sum;
+        /** Elemente der Rohdatei */
+        uint64_t count;
+        /** Eintrge der Stufe darunter */
+        size_t children{0};
+    };
+
+    static V castValue(const T &element) {
+        return static_cast<V>(element);
+    }
+
+    void run() {
+        std::vector<T> chunk(chunkLength_);
+        uint64_t built = 0;
+        bool ok = true;
+        while (ok && built < header_.nElements && !stop_.load(std::memory_order_relaxed)) {
+            const size_t wanted = static_cast<size_t>(std::min<uint64_t>(chunkLength_, header_.nElements - built));
+            const size_t n = source_.read(chunk.data(), sizeof(T), wanted, static_cast<size_t>(built));
+            for (size_t i = 0; i < n; i++) {
+                const V v = value_(chunk[i]);
+                add(1, v, v, static_cast<double>(v), 1);
+            }
+            built += n;
+            ok = n == wanted;  // sonst ist die Rohdatei krzer geworden
+            if (ok && built == header_.nElements) {
+                // Angefangene Eintrge abschliessen, von unten her, damit sie noch in die nchste Stufe kommen
+                for (unsigned int level = 1; level <= levels_; level++) {
+                    if (accumulators_[level].children > 0) {
+                        emit(level);
+                    }
+                }
+            }
+            ok = ok && writePending() && writeBuiltElements(built);
+            if (ok) {
+                builtElements_.store(built, std::memory_order_release);
+            }
+        }
+        if (!ok) {
+            valid_.store(false, std::memory_order_release);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        finishedCondition_.notify_all();
+    }
+
+    /** Trgt einen Eintrag der Stufe level - 1 (bzw. ein Element fr level 1) in die Stufe level ein */
+    void add(unsigned int level, V min, V max, double sum, uint64_t count) {
+        Accumulator_t &a = accumulators_[level];
+        if (a.children == 0) {
+            a.min = min;
+            a.max = max;
+            a.sum = sum;
+            a.count = count;
+        } else {
+            a.min = std::min(a.min, min);
+            a.max = std::max(a.max, max);
+            a.sum += sum;
+            a.count += count;
+        }
+        if (++a.children == header_.factor) {
+            emit(level);
+        }
+    }
+
+    void emit(unsigned int level) {
+        Accumulator_t &a = accumulators_[level];
+        pending_[level].push_back(Entry_t{ a.min, a.max, a.sum / static_cast<double>(a.count) });
+        a.children = 0;
+        if (level < levels_) {
+            add(level + 1, a.min, a.max, a.sum, a.count);
+        }
+    }
+
+    bool writePending() {
+        for (unsigned int level = 1; level <= levels_; level++) {
+            std::vector<Entry_t> &entries = pending_[level];
+            if (entries.empty()) {
+                continue;
+            }
+            if (!seek(PyramidFormat::levelOffset(header_, level) + written_[level] * sizeof(Entry_t))
+                || fwrite(entries.data(), sizeof(Entry_t), entries.size(), file_) != entries.size()) {
+                return false;
+            }
+            written_[level] += entries.size();
+            entries.clear();
+        }
+        // Die Eintrge mssen fr Leser sichtbar sein, bevor es der Header sagt
+        return fflush(file_) == 0;
+    }
+
+    bool writeBuiltElements(uint64_t built) {
+        header_.builtElements = built;
+        return seek(0) && fwrite(&header_, sizeof(header_), 1, file_) == 1 && fflush(file_) == 0;
+    }
+
+    /** fseek mit 64-Bit-Offset */
+    bool seek(uint64_t offset) {
+#if defined(_WIN32)
+        return _fseeki64(file_, static_cast<int64_t>(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file_, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    IReadEngine &source_;
+    const size_t chunkLength_;
+    V (*const value_)(const T &);
+    PyramidFormat::Header_t header_;
+    unsigned int levels_{1};
+    FILE *file_{nullptr};
+    std::atomic<bool> valid_{false};
+    std::atomic<uint64_t> builtElements_{0};
+    std::atomic<bool> stop_{false};
+    /** Index: Stufe (0 unbenutzt). Nur im Thread des Builders. */
+    std::vector<Accumulator_t> accumulators_;
+    /** Noch nicht geschriebene Eintrge. Index: Stufe */
+    std::vector<std::vector<Entry_t>> pending_;
+    /** Geschriebene Eintrge. Index: Stufe */
+    std::vector<uint64_t> written_;
+    std::mutex mutex_;
+    std::condition_variable finishedCondition_;
+    /** Kein Durchgang (mehr) am Laufen, fertig oder nicht. Geschtzt durch mutex_. */
+    bool finished_{true};
+    std::thread thread_;
+};
+
+/**
+ * IReadEngine fr eine Stufe einer Begleitdatei im PyramidFormat. Die Elemente sind PyramidEntry_t<V>, ein Buffer
+ * darber liest die Stufe also wie jede andere Datei, vorwrts, rckwrts und mit seek:
+ *
+ *     PreadReadEngine sidecar{fd};  // recording.pyr
+ *     PyramidReadEngine level{sidecar, PyramidFormat::levelFor(nElements, screenWidth, 16, nLevels)};
+ *     CircularBidirectionalFilereaderBuffer<PyramidEntry_t<double>, 4096> overview{level};
+ *
+ * Solange die Begleitdatei noch gebaut wird, liefert die Engine nur die fertigen Eintrge; im Folgemodus
+ * (CircularBidirectionalFilereaderBuffer#setFollow, angestossen mit notifyFileGrown) kommen die weiteren dazu.
+ */
+class PyramidReadEngine : public IReadEngine {
+public:
+
+    /**
+     * @param engine liest die Begleitdatei. Muss lnger leben als diese.
+     * @param level Stufe, 1 bis #levels
+     */
+    PyramidReadEngine(IReadEngine &engine, unsigned int level) : engine_(engine), level_(level) {
+        if (engine_.read(&header_, 1, sizeof(header_), 0) != sizeof(header_) || header_.magic != PyramidFormat::MAGIC
+            || header_.version != PyramidFormat::VERSION || header_.factor < 2 || header_.entrySize == 0
+            || level < 1 || level > levels()) {
+            return;
+        }
+        offset_ = PyramidFormat::levelOffset(header_, level);
+        valid_ = true;
+    }
+
+    PyramidReadEngine(const PyramidReadEngine &) = delete;
+    PyramidReadEngine &operator=(const PyramidReadEngine &) = delete;
+
+    /** @return false, wenn die Datei nicht im PyramidFormat ist oder die Stufe nicht hat. Dann liefert #read nichts und #size 0. */
+    bool isValid() const {
+        return valid_;
+    }
+
+    /** @return Anzahl Stufen ber der Rohdatei */
+    unsigned int levels() const {
+        return PyramidFormat::levels(header_.nElements, header_.factor);
+    }
+
+    /** @return Elemente der Rohdatei pro Eintrag dieser Stufe */
+    uint64_t span() const {
+        return PyramidFormat::span(level_, header_.factor);
+    }
+
+    /** @return Elemente der Rohdatei, fr die die Pyramide gebaut wird */
+    uint64_t rawElements() const {
+        return header_.nElements;
+    }
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        assert(!valid_ || elementSize == header_.entrySize);
+        const uint64_t entries = availableEntries();
+        if (first >= entries) {
+            return 0;
+        }
+        count = static_cast<size_t>(std::min<uint64_t>(count, entries - first));
+        return engine_.read(dest, 1, count * elementSize, static_cast<size_t>(offset_ + static_cast<uint64_t>(first) * elementSize)) / elementSize;
+    }
+
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        if (valid_) {
+            engine_.prefetch(1, count * elementSize, static_cast<size_t>(offset_ + static_cast<uint64_t>(first) * elementSize));
+        }
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        (void)elementSize;
+        return static_cast<size_t>(availableEntries());
+    }
+
+private:
+
+    /** @return fertige Eintrge dieser Stufe. Solange noch gebaut wird, mit dem aktuellen Stand aus dem Header. */
+    uint64_t availableEntries() {
+        if (!valid_) {
+            return 0;
+        }
+        if (header_.builtElements < header_.nElements) {
+            uint64_t built;
+            if (engine_.read(&built, 1, sizeof(built), offsetof(PyramidFormat::Header_t, builtElements)) == sizeof(built)) {
+                header_.builtElements = built;
+            }
+        }
+        return PyramidFormat::entries(header_, level_, header_.builtElements);
+    }
+
+    IReadEngine &engine_;
+    const unsigned int level_;
+    PyramidFormat::Header_t header_{};
+    /** Byte-Offset der Stufe in der Datei */
+    uint64_t offset_{0};
+    bool valid_{false};
+};
+
+#endif
@@ -0,0 +1,251 @@
+
+#ifndef POSIXREADENGINES_HPP_
+#define POSIXREADENGINES_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <linux/io_uring.h>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * IReadEngine mit pread auf einem File-Deskriptor (POSIX). Jeder Lesevorgang gibt seinen Offset mit, es gibt keinen
+ * gemeinsamen Dateizeiger und kein fseek. #prefetch reicht den Hinweis mit posix_fadvise an den Kernel weiter.
+ */
+class PreadReadEngine : public IReadEngine {
+public:
+
+    /** @param fd zum Lesen geffnete Datei. Bleibt im Besitz des Aufrufers. */
+    PreadReadEngine(int fd) : fd_(fd) {
+        // Die Reihenfolge bestimmen die Fills, nicht das Readahead des Kernels
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_RANDOM);
+    }
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        return preadFully(dest, count * elementSize, static_cast<uint64_t>(first) * elementSize) / elementSize;
+    }
+
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        posix_fadvise(fd_, static_cast<off_t>(static_cast<uint64_t>(first) * elementSize), static_cast<off_t>(count * elementSize), POSIX_FADV_WILLNEED);
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            return std::numeric_limits<size_t>::max();
+        }
+        return static_cast<size_t>(static_cast<uint64_t>(st.st_size) / elementSize);
+    }
+
+protected:
+
+    /** pread bis length Bytes gelesen sind oder das Dateiende erreicht ist. @return gelesene Bytes */
+    size_t preadFully(void *dest, size_t length, uint64_t offset) {
+        size_t done = 0;
+        while (done < length) {
+            const ssize_t n = pread(fd_, static_cast<char *>(dest) + done, length - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        return done;
+    }
+
+    int fd_;
+};
+
+/**
+ * IReadEngine mit io_uring (Linux ab 5.6). #prefetch reicht ein IORING_OP_READ in einen Zwischenpuffer ein und kehrt
+ * sofort zurck; der Kernel liest, whrend der Leser das eben gefllte Viertel konsumiert. Der nchste Fill kopiert
+ * dann nur noch aus dem Zwischenpuffer. Liegt ein Lesevorgang nicht im vorgeladenen Bereich, wird mit pread gelesen.
+ *
+ * Es ist hchstens ein Lesevorgang ausstehend. Wie die anderen Engines nur aus einem Thread (dem Fller) verwenden.
+ * Wenn der Kernel kein io_uring anbietet (oder es z.B. per seccomp gesperrt ist), verhlt sich die Engine wie
+ * PreadReadEngine, @see isAvailable.
+ */
+class IoUringReadEngine : public PreadReadEngine {
+public:
+
+    /**
+     * @param fd zum Lesen geffnete Datei. Bleibt im Besitz des Aufrufers.
+     * @param stagingBytes Grsse des Zwischenpuffers. Sollte mindestens ein Viertel des Caches fassen.
+     */
+    IoUringReadEngine(int fd, size_t stagingBytes) : PreadReadEngine(fd), stagingBytes_(stagingBytes) {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, 4, &params));
+        if (ringFd_ < 0) {
+            return;
+        }
+        sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            sqRingBytes_ = cqRingBytes_ = std::max(sqRingBytes_, cqRingBytes_);
+        }
+        sqRing_ = mmap(nullptr, sqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+        cqRing_ = singleMmap ? sqRing_ : mmap(nullptr, cqRingBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        sqesBytes_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        void *sqes = mmap(nullptr, sqesBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+        if (sqes != MAP_FAILED) {
+            sqes_ = static_cast<struct io_uring_sqe *>(sqes);  // schon jetzt, damit release() es auch bei Fehlern unten freigibt
+        }
+        staging_ = static_cast<char *>(malloc(stagingBytes_));
+        if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes == MAP_FAILED || staging_ == nullptr) {
+            release();
+            return;
+        }
+        char *sq = static_cast<char *>(sqRing_);
+        char *cq = static_cast<char *>(cqRing_);
+        sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    ~IoUringReadEngine() {
+        if (pending_) {
+            waitForCompletion();
+        }
+        release();
+    }
+
+    IoUringReadEngine(const IoUringReadEngine &) = delete;
+    IoUringReadEngine &operator=(const IoUringReadEngine &) = delete;
+
+    /** @return false, wenn io_uring nicht eingerichtet werden konnte. Dann wird nur mit pread gelesen. */
+    bool isAvailable() const {
+        return sqes_ != nullptr;
+    }
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        const uint64_t offset = static_cast<uint64_t>(first) * elementSize;
+        const size_t length = count * elementSize;
+        if (stagedRequested_ > 0 && offset >= stagedOffset_ && offset + length <= stagedOffset_ + stagedRequested_) {
+            if (pending_) {
+                waitForCompletion();
+            }
+            // Kurz vorgeladen heisst nur: damals das Dateiende. Im Folgemodus kann sie inzwischen gewachsen sein, darum
+            // nur ganz vorgeladene Bereiche aus dem Zwischenpuffer, den Rest mit pread.
+            if (offset + length <= stagedOffset_ + stagedLength_) {
+                memcpy(dest, staging_ + static_cast<size_t>(offset - stagedOffset_), length);
+                return count;
+            }
+        }
+        return PreadReadEngine::read(dest, elementSize, count, first);
+    }
+
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        if (!isAvailable()) {
+            PreadReadEngine::prefetch(elementSize, count, first);
+            return;
+        }
+        if (pending_) {
+            waitForCompletion();  // Der Zwischenpuffer wird wiederverwendet
+        }
+        stagedOffset_ = static_cast<uint64_t>(first) * elementSize;
+        stagedRequested_ = std::min(count * elementSize, stagingBytes_ / elementSize * elementSize);
+        stagedLength_ = 0;
+        const unsigned tail = *sqTail_;
+        const unsigned index = tail & sqMask_;
+        struct io_uring_sqe *sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd_;
+        sqe->off = stagedOffset_;
+        sqe->addr = reinterpret_cast<unsigned long long>(staging_);
+        sqe->len = static_cast<unsigned>(stagedRequested_);
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+        if (syscall(__NR_io_uring_enter, ringFd_, 1, 0, 0, nullptr, 0) == 1) {
+            pending_ = true;
+        } else {
+            __atomic_store_n(sqTail_, tail, __ATOMIC_RELEASE);
+            stagedRequested_ = 0;
+        }
+    }
+
+private:
+
+    /** Wartet auf den ausstehenden Lesevorgang. Bei einem Fehler bleibt der vorgeladene Bereich leer. */
+    void waitForCompletion() {
+        for (;;) {
+            const unsigned head = *cqHead_;
+            if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                const int res = cqes_[head & cqMask_].res;
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                pending_ = false;
+                if (res < 0) {
+                    stagedRequested_ = 0;
+                    stagedLength_ = 0;
+                } else {
+                    // Ein kurzer Lesevorgang ist nicht unbedingt das Dateiende: den Rest synchron nachlesen
+                    stagedLength_ = static_cast<size_t>(res) + preadFully(staging_ + res, stagedRequested_ - res, stagedOffset_ + res);
+                }
+                return;
+            }
+            syscall(__NR_io_uring_enter, ringFd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        }
+    }
+
+    void release() {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqesBytes_);
+        }
+        if (cqRing_ != nullptr && cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingBytes_);
+        }
+        if (sqRing_ != nullptr && sqRing_ != MAP_FAILED) {
+            munmap(sqRing_, sqRingBytes_);
+        }
+        if (ringFd_ >= 0) {
+            close(ringFd_);
+        }
+        free(staging_);
+        sqes_ = nullptr;
+        sqRing_ = cqRing_ = nullptr;
+        staging_ = nullptr;
+        ringFd_ = -1;
+    }
+
+    int ringFd_{-1};
+    void *sqRing_{nullptr};
+    void *cqRing_{nullptr};
+    size_t sqRingBytes_{0};
+    size_t cqRingBytes_{0};
+    size_t sqesBytes_{0};
+    unsigned *sqTail_{nullptr};
+    unsigned sqMask_{0};
+    unsigned *sqArray_{nullptr};
+    struct io_uring_sqe *sqes_{nullptr};
+    unsigned *cqHead_{nullptr};
+    unsigned *cqTail_{nullptr};
+    unsigned cqMask_{0};
+    struct io_uring_cqe *cqes_{nullptr};
+    /** Zwischenpuffer fr den vorgeladenen Bereich */
+    char *staging_{nullptr};
+    size_t stagingBytes_;
+    /** Byte-Offset in der Datei des vorgeladenen Bereichs */
+    uint64_t stagedOffset_{0};
+    /** Angeforderte Bytes des vorgeladenen Bereichs */
+    size_t stagedRequested_{0};
+    /** Tatschlich gelesene Bytes. Gltig, wenn !pending_ */
+    size_t stagedLength_{0};
+    /** Ein IORING_OP_READ ist eingereicht, aber noch nicht abgeholt */
+    bool pending_{false};
+};
+
+#endif
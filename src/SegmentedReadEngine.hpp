@@ -0,0 +1,176 @@
+#ifndef SEGMENTEDREADENGINE_HPP_
+#define SEGMENTEDREADENGINE_HPP_
+
+#include <stdio.h> // FILE
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * IReadEngine ber eine Folge von Dateien, z.B. rotierte Aufzeichnungen capture.000, capture.001, ..., die
+ * hintereinander als ein einziger Bytestrom gelesen werden. Die Segmente mssen keine ganzen Elemente enthalten; ein
+ * Element ber einer Segmentgrenze wird aus beiden Segmenten zusammengesetzt. Ein Fill, der ber eine Grenze geht,
+ * liest einfach aus beiden Segmenten, aufwrts wie abwrts.
+ *
+ * Geffnet wird ein Segment erst, wenn daraus gelesen wird, und offen bleiben nur die maxOpenFiles zuletzt benutzten.
+ * Die Grsse eines Segments wird erst bestimmt, wenn eine Position dahinter gebraucht wird, und dann gemerkt: ausser
+ * dem letzten drfen sich die Segmente also nicht mehr ndern. Das letzte darf wachsen (Folgemodus). Kann ein Segment
+ * nicht gelesen werden, endet der Strom davor.
+ * Wie StdioReadEngine nur aus einem Thread verwenden.
+ *
+ *     SegmentedReadEngine engine{SegmentedReadEngine::numberedSegments("capture")};
+ *     myBufferType buffer{engine};
+ */
+class SegmentedReadEngine : public IReadEngine {
+public:
+
+    /**
+     * @param paths Segmente in der Reihenfolge, in der sie gelesen werden
+     * @param maxOpenFiles so viele Segmente bleiben hchstens gleichzeitig geffnet
+     */
+    SegmentedReadEngine(std::vector<std::string> paths, size_t maxOpenFiles = 4) :
+        paths_(std::move(paths)), maxOpenFiles_(std::max<size_t>(maxOpenFiles, 1)), usable_(paths_.size()) {}
+
+    ~SegmentedReadEngine() {
+        for (OpenSegment_t &open : open_) {
+            fclose(open.file);
+        }
+    }
+
+    SegmentedReadEngine(const SegmentedReadEngine &) = delete;
+    SegmentedReadEngine &operator=(const SegmentedReadEngine &) = delete;
+
+    /**
+     * @return base.000, base.001, ... so weit es sie lckenlos gibt
+     * @param digits Stellen der Nummer, mit Nullen aufgefllt
+     */
+    static std::vector<std::string> numberedSegments(const std::string &base, unsigned int digits = 3) {
+        std::vector<std::string> paths;
+        while (true) {
+            std::string number = std::to_string(paths.size());
+            if (number.size() < digits) {
+                number.insert(0, digits - number.size(), '0');
+            }
+            std::string path = base + "." + number;
+            std::error_code error;
+            if (!std::filesystem::is_regular_file(path, error)) {
+                return paths;
+            }
+            paths.push_back(std::move(path));
+        }
+    }
+
+    /** @return Anzahl Segmente */
+    size_t segmentCount() const {
+        return paths_.size();
+    }
+
+    /** @return Anzahl im Moment geffneter Segmente */
+    size_t openFiles() const {
+        return open_.size();
+    }
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        const uint64_t offset = static_cast<uint64_t>(first) * elementSize;
+        const size_t length = count * elementSize;
+        size_t done = 0;
+        while (done < length) {
+            const size_t segment = locate(offset + done);
+            if (segment >= usable_) {
+                break;
+            }
+            const uint64_t inSegment = offset + done - startOf(segment);
+            size_t wanted = length - done;
+            if (segment < ends_.size()) {
+                // Nicht das letzte: nur bis zur Grenze, der Rest kommt aus dem nchsten
+                wanted = static_cast<size_t>(std::min<uint64_t>(wanted, ends_[segment] - (offset + done)));
+            }
+            StdioReadEngine *engine = open(segment);
+            const size_t n = engine != nullptr ? engine->read(static_cast<char *>(dest) + done, 1, wanted, static_cast<size_t>(inSegment)) : 0;
+            done += n;
+            if (n < wanted) {
+                break;  // Ende des letzten Segments, oder ein Segment ist krzer geworden
+            }
+        }
+        return done / elementSize;
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        locate(UINT64_MAX);
+        if (usable_ == 0) {
+            return 0;
+        }
+        // Das letzte Segment kann wachsen, darum jedes Mal neu
+        std::error_code error;
+        const uint64_t last = std::filesystem::file_size(paths_[usable_ - 1], error);
+        return static_cast<size_t>((startOf(usable_ - 1) + (error ? 0 : last)) / elementSize);
+    }
+
+private:
+
+    struct OpenSegment_t {
+        OpenSegment_t(size_t segment, FILE *file) : segment(segment), file(file), engine(file) {}
+        size_t segment;
+        FILE *file;
+        StdioReadEngine engine;
+    };
+
+    /** Byte-Offset im Strom des ersten Bytes von segment. @pre Grssen der Segmente davor bekannt */
+    uint64_t startOf(size_t segment) const {
+        return segment == 0 ? 0 : ends_[segment - 1];
+    }
+
+    /**
+     * Bestimmt die Grssen der Segmente bis zu dem, das offset enthlt.
+     * @return Index des Segments mit dem Byte offset. Liegt offset dahinter, das letzte (usable_ - 1).
+     */
+    size_t locate(uint64_t offset) {
+        while (ends_.size() + 1 < usable_ && (ends_.empty() || ends_.back() <= offset)) {
+            std::error_code error;
+            const uint64_t size = std::filesystem::file_size(paths_[ends_.size()], error);
+            if (error) {
+                usable_ = ends_.size() + 1;  // nicht lesbar: der Strom endet mit diesem (leeren) Segment
+                break;
+            }
+            ends_.push_back(startOf(ends_.size()) + size);
+        }
+        return static_cast<size_t>(std::upper_bound(ends_.begin(), ends_.end(), offset) - ends_.begin());
+    }
+
+    /** @return Engine auf dem geffneten segment, nullptr wenn es sich nicht ffnen lsst */
+    StdioReadEngine *open(size_t segment) {
+        for (auto it = open_.begin(); it != open_.end(); ++it) {
+            if (it->segment == segment) {
+                open_.splice(open_.begin(), open_, it);
+                return &open_.front().engine;
+            }
+        }
+        FILE *file = fopen(paths_[segment].c_str(), "rb");
+        if (file == nullptr) {
+            return nullptr;
+        }
+        if (open_.size() >= maxOpenFiles_) {
+            fclose(open_.back().file);
+            open_.pop_back();
+        }
+        open_.emplace_front(segment, file);
+        return &open_.front().engine;
+    }
+
+    const std::vector<std::string> paths_;
+    const size_t maxOpenFiles_;
+    /** Segmente ab hier gehren nicht zum Strom, @see locate */
+    size_t usable_;
+    /** ends_[i]: Byte-Offset im Strom hinter Segment i. Nur fr die schon bestimmten, nie fr das letzte. */
+    std::vector<uint64_t> ends_;
+    /** Geffnete Segmente, zuletzt benutztes vorne */
+    std::list<OpenSegment_t> open_;
+};
+
+#endif
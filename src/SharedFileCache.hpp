@@ -0,0 +1,368 @@
+
+#ifndef SHAREDFILECACHE_HPP_
+#define SHAREDFILECACHE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * Gemeinsamer Cache fr eine Datei, ber den mehrere Leser mit je einem eigenen SharedFileCache::Cursor lesen.
+ *
+ * Statt eines Rings pro Leser gibt es Blcke von blockLength Elementen, die nach Anzahl Cursor gezhlt werden, die sie
+ * gerade festhalten. Ein Cursor hlt seinen aktuellen und den zuletzt verlassenen Block; liegen zwei Cursor im selben
+ * Block, teilen sie ihn, gelesen wird er nur einmal. Nicht mehr festgehaltene Blcke bleiben bis zu maxIdleBlocks Stck
+ * im Speicher (LRU) und knnen von einem anderen Cursor wiederverwendet werden.
+ *
+ * Vorausgeladen wird pro Cursor: betritt er einen Block, ldt ein Worker-Thread des Caches den nchsten in seiner
+ * Richtung. Die Engine wird nur unter einem Mutex verwendet, die Cursor knnen in verschiedenen Threads laufen (ein
+ * Cursor aber nur in einem).
+ *
+ *     PreadReadEngine engine{fd};
+ *     SharedFileCache<myDataType> cache{engine, 4096, 16};
+ *     SharedFileCache<myDataType>::Cursor plotter{cache};
+ *     SharedFileCache<myDataType>::Cursor exporter{cache, 1000000};
+ *     ...
+ *     cache.tearDown();  // nachdem alle Cursor weg sind
+ *
+ * @tparam T Typ der Datenelemente
+ */
+template <class T>
+class SharedFileCache {
+public:
+
+    /** Wie CircularBidirectionalFilereaderBuffer::CacheState_t. ALMOST_EMPTY kommt nicht vor: ein Cursor wartet auf den Block. */
+    enum class CacheState_t {
+        OK,
+        ALMOST_EMPTY,
+        END_OF_FILE,
+        CACHE_OVERFLOW
+    };
+
+    struct Stats_t {
+        /** Blcke im Speicher, festgehaltene und freie */
+        size_t residentBlocks;
+        /** Davon von keinem Cursor festgehalten */
+        size_t idleBlocks;
+        /** Von der Engine gelesene Blcke */
+        uint64_t loads;
+        /** Blcke, die ein Cursor schon im Speicher (oder gerade im Laden) vorgefunden hat */
+        uint64_t hits;
+    };
+
+    class Cursor;
+
+    /**
+     * @param engine liest die Elemente aus der Datei. Muss lnger leben als der Cache und ihre Grsse kennen (IReadEngine#size).
+     * @param blockLength Anzahl Elemente pro Block
+     * @param maxIdleBlocks Anzahl Blcke, die ohne Cursor im Speicher bleiben. Vorausgeladene Blcke zhlen dazu, darum
+     *                      mindestens einer pro Cursor.
+     */
+    SharedFileCache(IReadEngine &engine, size_t blockLength, size_t maxIdleBlocks) :
+        engine_(engine), blockLength_(blockLength), maxIdleBlocks_(maxIdleBlocks), size_(engine.size(sizeof(T))) {
+        assert(blockLength > 0);
+        assert(size_ > 0 && size_ != std::numeric_limits<size_t>::max());  // Grsse muss bekannt sein
+    }
+
+    ~SharedFileCache() {
+        assert(!worker_.joinable());  // vorher tearDown aufrufen
+    }
+
+    SharedFileCache(const SharedFileCache &) = delete;
+    SharedFileCache &operator=(const SharedFileCache &) = delete;
+
+    /** Beendet den Worker-Thread. Vorher alle Cursor zerstren. */
+    void tearDown() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            keepRunning_ = false;
+        }
+        workAvailable_.notify_one();
+        worker_.join();
+    }
+
+    /** @return Anzahl Elemente in der Datei */
+    size_t size() const {
+        return size_;
+    }
+
+    Stats_t stats() const {
+        std::lock_guard<std::mutex> lock{mutex_};
+        Stats_t stats;
+        stats.residentBlocks = blocks_.size();
+        stats.idleBlocks = idle_.size();
+        stats.loads = loads_.load(std::memory_order_relaxed);
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+
+    struct Block_t {
+        std::unique_ptr<T[]> data;
+        /** Gltige Elemente. Gltig, wenn !loading */
+        size_t length{0};
+        /** Anzahl Cursor, die den Block festhalten */
+        size_t refs{0};
+        bool loading{true};
+        /** In idle_ eingetragen */
+        bool idle{false};
+        std::list<uint64_t>::iterator idlePosition;
+    };
+
+    /** Hlt den Block fest. Liegt er nicht im Speicher, wird er gelesen; ldt ihn gerade ein anderer, wird gewartet. */
+    const Block_t &acquire(uint64_t index) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        const auto found = blocks_.find(index);
+        if (found != blocks_.end()) {
+            Block_t &block = found->second;
+            if (block.idle) {
+                idle_.erase(block.idlePosition);
+                block.idle = false;
+            }
+            block.refs++;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            loaded_.wait(lock, [&block] { return !block.loading; });
+            return block;
+        }
+        Block_t &block = blocks_[index];  // Knoten bleiben beim Einfgen anderer Blcke, wo sie sind
+        block.refs = 1;
+        lock.unlock();
+        load(index, block);
+        lock.lock();
+        block.loading = false;
+        loaded_.notify_all();
+        return block;
+    }
+
+    void release(uint64_t index) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        Block_t &block = blocks_.at(index);
+        assert(block.refs > 0);
+        if (--block.refs == 0) {
+            makeIdle(index, block);
+        }
+    }
+
+    /** Lsst den Block vom Worker-Thread laden, wenn er nicht schon im Speicher oder angefordert ist. */
+    void prefetch(uint64_t index) {
+        if (index >= (size_ + blockLength_ - 1) / blockLength_) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (blocks_.count(index) != 0 || std::find(prefetchQueue_.begin(), prefetchQueue_.end(), index) != prefetchQueue_.end()) {
+                return;
+            }
+            prefetchQueue_.push_back(index);
+            if (prefetchQueue_.size() > std::max<size_t>(maxIdleBlocks_, 1)) {
+                prefetchQueue_.pop_front();  // zu alt, der Cursor ist wohl schon weiter
+            }
+        }
+        workAvailable_.notify_one();
+    }
+
+    /** Unter mutex_ */
+    void makeIdle(uint64_t index, Block_t &block) {
+        idle_.push_back(index);
+        block.idlePosition = std::prev(idle_.end());
+        block.idle = true;
+        while (idle_.size() > maxIdleBlocks_) {
+            blocks_.erase(idle_.front());
+            idle_.pop_front();
+        }
+    }
+
+    /** Liest den Block. Ohne mutex_, aber unter engineMutex_: die Engines sind nicht fr mehrere Threads gemacht. */
+    void load(uint64_t index, Block_t &block) {
+        const size_t first = static_cast<size_t>(index * blockLength_);
+        const size_t n = std::min(blockLength_, size_ - first);
+        block.data.reset(new T[n]);
+        std::lock_guard<std::mutex> lock{engineMutex_};
+        block.length = engine_.read(block.data.get(), sizeof(T), n, first);
+        loads_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true) {
+            workAvailable_.wait(lock, [this] { return !keepRunning_ || !prefetchQueue_.empty(); });
+            if (!keepRunning_) {
+                break;
+            }
+            const uint64_t index = prefetchQueue_.front();
+            prefetchQueue_.pop_front();
+            if (blocks_.count(index) != 0) {
+                continue;
+            }
+            Block_t &block = blocks_[index];
+            lock.unlock();
+            load(index, block);
+            lock.lock();
+            block.loading = false;
+            loaded_.notify_all();
+            if (block.refs == 0) {
+                makeIdle(index, block);
+            }
+        }
+    }
+
+    IReadEngine &engine_;
+    const size_t blockLength_;
+    const size_t maxIdleBlocks_;
+    const size_t size_;
+    /** Schtzt blocks_, idle_, prefetchQueue_ und die Verwaltungsdaten der Blcke (nicht deren Elemente) */
+    mutable std::mutex mutex_;
+    std::mutex engineMutex_;
+    /** Ein Block ist fertig geladen */
+    std::condition_variable loaded_;
+    std::condition_variable workAvailable_;
+    std::unordered_map<uint64_t, Block_t> blocks_;
+    /** Nicht festgehaltene Blcke, vorne der am lngsten nicht verwendete */
+    std::list<uint64_t> idle_;
+    std::deque<uint64_t> prefetchQueue_;
+    bool keepRunning_{true};
+    std::atomic<uint64_t> loads_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::thread worker_{&SharedFileCache::run, this};  // zuletzt, damit run() nur initialisierte Member sieht
+};
+
+/**
+ * Lesezeiger in einem SharedFileCache, mit getNext/getPrev/getCurrent wie CircularBidirectionalFilereaderBuffer.
+ * Nur aus einem Thread verwenden. Innerhalb eines Blocks ohne Lock; erst beim Wechsel in einen anderen Block wird der
+ * Cache gefragt (und, wenn der Block noch nicht geladen ist, gewartet).
+ */
+template <class T>
+class SharedFileCache<T>::Cursor {
+public:
+
+    typedef typename SharedFileCache::CacheState_t CacheState_t;
+
+    /** @param position Element-Index, auf dem der Cursor anfngt */
+    Cursor(SharedFileCache &cache, size_t position = 0) : cache_(cache) {
+        enter(std::min(position, cache_.size() - 1), true);
+    }
+
+    ~Cursor() {
+        cache_.release(current_);
+        if (previous_ != NONE) {
+            cache_.release(previous_);
+        }
+    }
+
+    Cursor(const Cursor &) = delete;
+    Cursor &operator=(const Cursor &) = delete;
+
+    void getCurrent(T &ele) const {
+        ele = data_[offset_];
+    }
+
+    /**
+     * @return OK, END_OF_FILE, wenn ele das letzte Element der Datei ist. Stand der Cursor schon dort, bleibt er stehen.
+     */
+    CacheState_t getNext(T &ele) {
+        const size_t position = first_ + offset_;
+        if (position + 1 < cache_.size()) {
+            if (offset_ + 1 < length_) {
+                offset_++;
+            } else {
+                enter(position + 1, true);
+            }
+        }
+        ele = data_[offset_];
+        return first_ + offset_ + 1 == cache_.size() ? CacheState_t::END_OF_FILE : CacheState_t::OK;
+    }
+
+    /**
+     * @return OK, END_OF_FILE, wenn ele das erste Element der Datei ist. Stand der Cursor schon dort, bleibt er stehen.
+     */
+    CacheState_t getPrev(T &ele) {
+        if (offset_ > 0) {
+            offset_--;
+        } else if (first_ > 0) {
+            enter(first_ - 1, false);
+        }
+        ele = data_[offset_];
+        return first_ + offset_ == 0 ? CacheState_t::END_OF_FILE : CacheState_t::OK;
+    }
+
+    /**
+     * Setzt den Cursor auf das Element elementIndex der Datei.
+     * @return OK, oder CACHE_OVERFLOW, wenn elementIndex hinter dem Dateiende liegt. Dann steht der Cursor auf dem letzten Element.
+     */
+    CacheState_t seek(size_t elementIndex) {
+        CacheState_t retVal{ CacheState_t::OK };
+        if (elementIndex >= cache_.size()) {
+            elementIndex = cache_.size() - 1;
+            retVal = CacheState_t::CACHE_OVERFLOW;
+        }
+        enter(elementIndex, elementIndex >= first_ + offset_);
+        return retVal;
+    }
+
+    /** @return Element-Index in der Datei der aktuellen Position */
+    size_t position() const {
+        return first_ + offset_;
+    }
+
+private:
+
+    static constexpr uint64_t NONE{ std::numeric_limits<uint64_t>::max() };
+
+    /** Setzt die Position, wechselt wenn ntig den Block und ldt den nchsten in Richtung up voraus. */
+    void enter(size_t position, bool up) {
+        const uint64_t index = position / cache_.blockLength_;
+        if (index != current_) {
+            if (index == previous_) {
+                std::swap(current_, previous_);
+                std::swap(block_, previousBlock_);
+            } else {
+                if (previous_ != NONE) {
+                    cache_.release(previous_);
+                }
+                previous_ = current_;
+                previousBlock_ = block_;
+                current_ = index;
+                block_ = &cache_.acquire(index);
+            }
+            data_ = block_->data.get();
+            first_ = static_cast<size_t>(index * cache_.blockLength_);
+            length_ = block_->length;
+            if (up) {
+                cache_.prefetch(index + 1);
+            } else if (index > 0) {
+                cache_.prefetch(index - 1);
+            }
+        }
+        offset_ = position - first_;
+        assert(offset_ < length_);  // sonst hat die Engine zu wenig geliefert
+    }
+
+    SharedFileCache &cache_;
+    /** Festgehaltene Blcke: der aktuelle und der zuletzt verlassene, damit Pendeln an einer Grenze nichts kostet */
+    uint64_t current_{NONE};
+    uint64_t previous_{NONE};
+    const Block_t *block_{nullptr};
+    const Block_t *previousBlock_{nullptr};
+    /** Elemente des aktuellen Blocks */
+    const T *data_{nullptr};
+    /** Element-Index in der Datei von data_[0] */
+    size_t first_{0};
+    size_t length_{0};
+    /** Position in data_ */
+    size_t offset_{0};
+};
+
+#endif
@@ -0,0 +1,505 @@
+#ifndef SPANKERNELS_HPP_
+#define SPANKERNELS_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+/**
+ * 0: Kernels (SpanKernels, DecodeKernels) nur skalar, auch wo SSE2, SSSE3 oder AVX2 verfgbar wren (z.B. zum
+ * Vergleichen). Sonst werden die Befehlsstze verwendet, fr die bersetzt wird (-mavx2, /arch:AVX2, ...).
+ * Vor dem ersten #include setzen, in allen bersetzungseinheiten gleich.
+ */
+#ifndef CIRCULARBIDIRECTIONALFILEREADERBUFFER_SIMD
+#define CIRCULARBIDIRECTIONALFILEREADERBUFFER_SIMD 1
+#endif
+
+#if CIRCULARBIDIRECTIONALFILEREADERBUFFER_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSSE3__) || defined(__AVX__)
+#define CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSSE3 1
+#include <tmmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>  // _BitScanForward, _BitScanReverse
+#endif
+
+/**
+ * Zusammenfassung eines Bereichs arithmetischer Werte, @see CircularBidirectionalFilereaderBuffer#reduceNext.
+ * min und max sind nur mit count > 0 gltig. Bei NaN in float- oder double-Werten sind sie unbestimmt.
+ */
+template <class V>
+struct SpanSummary_t {
+    static_assert(std::is_arithmetic<V>::value, "SpanSummary_t: nur fr arithmetische Typen");
+
+    /** double fr Gleitkomma-, int64_t bzw. uint64_t fr ganzzahlige Werte */
+    typedef typename std::conditional<std::is_floating_point<V>::value, double,
+        typename std::conditional<std::is_signed<V>::value, int64_t, uint64_t>::type>::type Sum_t;
+
+    /** Anzahl zusammengefasster Werte */
+    size_t count{0};
+    Sum_t sum{};
+    V min{};
+    V max{};
+
+    void add(V value) {
+        sum += static_cast<Sum_t>(value);
+        if (count == 0 || value < min) {
+            min = value;
+        }
+        if (count == 0 || value > max) {
+            max = value;
+        }
+        count++;
+    }
+
+    /** Fasst eine Zusammenfassung von n Werten mit deren Summe, Minimum und Maximum dazu */
+    void add(size_t n, Sum_t nSum, V nMin, V nMax) {
+        if (n == 0) {
+            return;
+        }
+        sum += nSum;
+        min = count == 0 || nMin < min ? nMin : min;
+        max = count == 0 || nMax > max ? nMax : max;
+        count += n;
+    }
+};
+
+/**
+ * Suchen und Zusammenfassen ber zusammenhngende Elemente, z.B. die Stcke eines Span_t. Vektorisiert mit AVX2 bzw.
+ * SSE2 fr float, double und ganze Zahlen zu 1, 2 und 4 Bytes (mit AVX2 auch 8 Bytes), sonst skalar.
+ * @see CircularBidirectionalFilereaderBuffer#findNext, CircularBidirectionalFilereaderBuffer#reduceNext
+ */
+class SpanKernels {
+public:
+
+    /** Prdikat: Wert grsser als threshold. Fr #find vektorisiert. */
+    template <class V>
+    struct Above {
+        V threshold;
+
+        bool operator()(const V &value) const {
+            return value > threshold;
+        }
+    };
+
+    /** Prdikat: Wert kleiner als threshold. Fr #find vektorisiert. */
+    template <class V>
+    struct Below {
+        V threshold;
+
+        bool operator()(const V &value) const {
+            return value < threshold;
+        }
+    };
+
+    /** @return "AVX2", "SSSE3", "SSE2" oder "scalar": die beste Variante, mit der bersetzt wurde */
+    static const char *instructionSet() {
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+        return "AVX2";
+#elif defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSSE3)
+        return "SSSE3";
+#elif defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    /**
+     * @return Index des ersten (forward) bzw. letzten (!forward) Elements in p[0, n), fr das predicate gilt. n, wenn keines.
+     */
+    template <class T, class PREDICATE>
+    static size_t find(const T *p, size_t n, const PREDICATE &predicate, bool forward) {
+        if (forward) {
+            for (size_t i = 0; i < n; i++) {
+                if (predicate(p[i])) {
+                    return i;
+                }
+            }
+        } else {
+            for (size_t i = n; i > 0; i--) {
+                if (predicate(p[i - 1])) {
+                    return i - 1;
+                }
+            }
+        }
+        return n;
+    }
+
+    /** @see find */
+    template <class V>
+    static size_t find(const V *p, size_t n, const Above<V> &predicate, bool forward) {
+        return forward ? findCrossing<true, true>(p, n, predicate.threshold) : findCrossing<true, false>(p, n, predicate.threshold);
+    }
+
+    /** @see find */
+    template <class V>
+    static size_t find(const V *p, size_t n, const Below<V> &predicate, bool forward) {
+        return forward ? findCrossing<false, true>(p, n, predicate.threshold) : findCrossing<false, false>(p, n, predicate.threshold);
+    }
+
+    /** Fasst p[0, n) zu summary dazu */
+    template <class V>
+    static void reduce(const V *p, size_t n, SpanSummary_t<V> &summary) {
+        size_t i = reduceVector(p, n, summary);
+        for (; i < n; i++) {
+            summary.add(p[i]);
+        }
+    }
+
+private:
+
+    /** Skalar: keine Vektor-Variante fr diesen Typ */
+    struct Scalar_t {
+        static constexpr size_t LANES{ 1 };
+    };
+
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+    template <class V>
+    struct Sse2Integer_t {
+        typedef __m128i Reg_t;
+        static constexpr size_t LANES{ 16 / sizeof(V) };
+        /** _mm_movemask_epi8 liefert ein Bit pro Byte */
+        static constexpr unsigned int BITS{ sizeof(V) };
+
+        static Reg_t set1(V value) {
+            return bias(broadcast(value));
+        }
+
+        static Reg_t load(const V *p) {
+            return bias(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        }
+
+        static Reg_t greater(Reg_t a, Reg_t b) {
+            if (sizeof(V) == 1) {
+                return _mm_cmpgt_epi8(a, b);
+            } else if (sizeof(V) == 2) {
+                return _mm_cmpgt_epi16(a, b);
+            }
+            return _mm_cmpgt_epi32(a, b);
+        }
+
+        static unsigned int mask(Reg_t x) {
+            return static_cast<unsigned int>(_mm_movemask_epi8(x));
+        }
+
+    private:
+
+        static Reg_t broadcast(V value) {
+            if (sizeof(V) == 1) {
+                return _mm_set1_epi8(static_cast<char>(value));
+            } else if (sizeof(V) == 2) {
+                return _mm_set1_epi16(static_cast<short>(value));
+            }
+            return _mm_set1_epi32(static_cast<int>(value));
+        }
+
+        /** Ohne Vorzeichen: oberstes Bit kippen, dann vergleicht cmpgt mit Vorzeichen richtig */
+        static Reg_t bias(Reg_t x) {
+            if constexpr (std::is_signed<V>::value) {
+                return x;
+            } else {
+                return _mm_xor_si128(x, broadcast(static_cast<V>(~(std::numeric_limits<V>::max() >> 1))));
+            }
+        }
+    };
+
+    struct Sse2Float_t {
+        typedef __m128 Reg_t;
+        static constexpr size_t LANES{ 4 };
+        static constexpr unsigned int BITS{ 1 };
+        static Reg_t set1(float value) { return _mm_set1_ps(value); }
+        static Reg_t load(const float *p) { return _mm_loadu_ps(p); }
+        static Reg_t greater(Reg_t a, Reg_t b) { return _mm_cmpgt_ps(a, b); }
+        static unsigned int mask(Reg_t x) { return static_cast<unsigned int>(_mm_movemask_ps(x)); }
+    };
+
+    struct Sse2Double_t {
+        typedef __m128d Reg_t;
+        static constexpr size_t LANES{ 2 };
+        static constexpr unsigned int BITS{ 1 };
+        static Reg_t set1(double value) { return _mm_set1_pd(value); }
+        static Reg_t load(const double *p) { return _mm_loadu_pd(p); }
+        static Reg_t greater(Reg_t a, Reg_t b) { return _mm_cmpgt_pd(a, b); }
+        static unsigned int mask(Reg_t x) { return static_cast<unsigned int>(_mm_movemask_pd(x)); }
+    };
+#endif
+
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+    template <class V>
+    struct Avx2Integer_t {
+        typedef __m256i Reg_t;
+        static constexpr size_t LANES{ 32 / sizeof(V) };
+        static constexpr unsigned int BITS{ sizeof(V) };
+
+        static Reg_t set1(V value) {
+            return bias(broadcast(value));
+        }
+
+        static Reg_t load(const V *p) {
+            return bias(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+        }
+
+        static Reg_t greater(Reg_t a, Reg_t b) {
+            if (sizeof(V) == 1) {
+                return _mm256_cmpgt_epi8(a, b);
+            } else if (sizeof(V) == 2) {
+                return _mm256_cmpgt_epi16(a, b);
+            } else if (sizeof(V) == 4) {
+                return _mm256_cmpgt_epi32(a, b);
+            }
+            return _mm256_cmpgt_epi64(a, b);
+        }
+
+        static unsigned int mask(Reg_t x) {
+            return static_cast<unsigned int>(_mm256_movemask_epi8(x));
+        }
+
+    private:
+
+        static Reg_t broadcast(V value) {
+            if (sizeof(V) == 1) {
+                return _mm256_set1_epi8(static_cast<char>(value));
+            } else if (sizeof(V) == 2) {
+                return _mm256_set1_epi16(static_cast<short>(value));
+            } else if (sizeof(V) == 4) {
+                return _mm256_set1_epi32(static_cast<int>(value));
+            }
+            return _mm256_set1_epi64x(static_cast<long long>(value));
+        }
+
+        static Reg_t bias(Reg_t x) {
+            if constexpr (std::is_signed<V>::value) {
+                return x;
+            } else {
+                return _mm256_xor_si256(x, broadcast(static_cast<V>(~(std::numeric_limits<V>::max() >> 1))));
+            }
+        }
+    };
+
+    struct Avx2Float_t {
+        typedef __m256 Reg_t;
+        static constexpr size_t LANES{ 8 };
+        static constexpr unsigned int BITS{ 1 };
+        static Reg_t set1(float value) { return _mm256_set1_ps(value); }
+        static Reg_t load(const float *p) { return _mm256_loadu_ps(p); }
+        static Reg_t greater(Reg_t a, Reg_t b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static unsigned int mask(Reg_t x) { return static_cast<unsigned int>(_mm256_movemask_ps(x)); }
+    };
+
+    struct Avx2Double_t {
+        typedef __m256d Reg_t;
+        static constexpr size_t LANES{ 4 };
+        static constexpr unsigned int BITS{ 1 };
+        static Reg_t set1(double value) { return _mm256_set1_pd(value); }
+        static Reg_t load(const double *p) { return _mm256_loadu_pd(p); }
+        static Reg_t greater(Reg_t a, Reg_t b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+        static unsigned int mask(Reg_t x) { return static_cast<unsigned int>(_mm256_movemask_pd(x)); }
+    };
+#endif
+
+    /** Vektor-Operationen fr V: die breitesten verfgbaren, Scalar_t wenn keine */
+    template <class V>
+    struct Vector {
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_AVX2)
+        typedef typename std::conditional<std::is_same<V, float>::value, Avx2Float_t,
+            typename std::conditional<std::is_same<V, double>::value, Avx2Double_t,
+            typename std::conditional<std::is_integral<V>::value && !std::is_same<V, bool>::value, Avx2Integer_t<V>,
+            Scalar_t>::type>::type>::type type;
+#elif defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+        typedef typename std::conditional<std::is_same<V, float>::value, Sse2Float_t,
+            typename std::conditional<std::is_same<V, double>::value, Sse2Double_t,
+            typename std::conditional<std::is_integral<V>::value && !std::is_same<V, bool>::value && sizeof(V) <= 4, Sse2Integer_t<V>,
+            Scalar_t>::type>::type>::type type;
+#else
+        typedef Scalar_t type;
+#endif
+    };
+
+    /**
+     * @return Index des ersten bzw. letzten Werts in p[0, n), der grsser (ABOVE) bzw. kleiner als threshold ist. n,
+     *         wenn keiner.
+     */
+    template <bool ABOVE, bool FORWARD, class V>
+    static size_t findCrossing(const V *p, size_t n, V threshold) {
+        typedef typename Vector<V>::type Vector_t;
+        auto crosses = [threshold](const V &value) { return ABOVE ? value > threshold : value < threshold; };
+        if constexpr (Vector_t::LANES > 1) {
+            const typename Vector_t::Reg_t t = Vector_t::set1(threshold);
+            if (FORWARD) {
+                size_t i = 0;
+                for (; i + Vector_t::LANES <= n; i += Vector_t::LANES) {
+                    const typename Vector_t::Reg_t x = Vector_t::load(p + i);
+                    const unsigned int m = Vector_t::mask(ABOVE ? Vector_t::greater(x, t) : Vector_t::greater(t, x));
+                    if (m != 0) {
+                        return i + lowestBit(m) / Vector_t::BITS;
+                    }
+                }
+                const size_t found = find(p + i, n - i, crosses, true);
+                return found < n - i ? i + found : n;
+            }
+            size_t i = n;
+            for (; i >= Vector_t::LANES; i -= Vector_t::LANES) {
+                const typename Vector_t::Reg_t x = Vector_t::load(p + i - Vector_t::LANES);
+                const unsigned int m = Vector_t::mask(ABOVE ? Vector_t::greater(x, t) : Vector_t::greater(t, x));
+                if (m != 0) {
+                    return i - Vector_t::LANES + highestBit(m) / Vector_t::BITS;
+                }
+            }
+            const size_t found = find(p, i, crosses, false);
+            return found < i ? found : n;
+        }
+        return find(p, n, crosses, FORWARD);
+    }
+
+    /** Ohne Vektor-Variante: nichts, der Rest wird skalar zusammengefasst. @return Anzahl zusammengefasster Werte */
+    template <class V>
+    static size_t reduceVector(const V *p, size_t n, SpanSummary_t<V> &summary) {
+        (void)p;
+        (void)n;
+        (void)summary;
+        return 0;
+    }
+
+#if defined(CIRCULARBIDIRECTIONALFILEREADERBUFFER_SSE2)
+    static size_t reduceVector(const float *p, size_t n, SpanSummary_t<float> &summary) {
+        if (n < 4) {
+            return 0;
+        }
+        // Summe in double, damit lange Bereiche nicht an Genauigkeit verlieren
+        __m128d sumLow = _mm_setzero_pd();
+        __m128d sumHigh = _mm_setzero_pd();
+        __m128 min = _mm_loadu_ps(p);
+        __m128 max = min;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m128 x = _mm_loadu_ps(p + i);
+            sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(x));
+            sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+            min = _mm_min_ps(min, x);
+            max = _mm_max_ps(max, x);
+        }
+        alignas(16) double sums[2];
+        _mm_store_pd(sums, _mm_add_pd(sumLow, sumHigh));
+        alignas(16) float mins[4];
+        alignas(16) float maxs[4];
+        _mm_store_ps(mins, min);
+        _mm_store_ps(maxs, max);
+        summary.add(i, sums[0] + sums[1], *std::min_element(mins, mins + 4), *std::max_element(maxs, maxs + 4));
+        return i;
+    }
+
+    static size_t reduceVector(const double *p, size_t n, SpanSummary_t<double> &summary) {
+        if (n < 2) {
+            return 0;
+        }
+        __m128d sum = _mm_setzero_pd();
+        __m128d min = _mm_loadu_pd(p);
+        __m128d max = min;
+        size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            const __m128d x = _mm_loadu_pd(p + i);
+            sum = _mm_add_pd(sum, x);
+            min = _mm_min_pd(min, x);
+            max = _mm_max_pd(max, x);
+        }
+        alignas(16) double sums[2];
+        alignas(16) double mins[2];
+        alignas(16) double maxs[2];
+        _mm_store_pd(sums, sum);
+        _mm_store_pd(mins, min);
+        _mm_store_pd(maxs, max);
+        summary.add(i, sums[0] + sums[1], std::min(mins[0], mins[1]), std::max(maxs[0], maxs[1]));
+        return i;
+    }
+
+    static size_t reduceVector(const int16_t *p, size_t n, SpanSummary_t<int16_t> &summary) {
+        if (n < 8) {
+            return 0;
+        }
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i sum = _mm_setzero_si128();
+        __m128i min = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i max = min;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            // Paarweise zu int32 (madd), dann auf int64 erweitert aufsummiert
+            sum = _mm_add_epi64(sum, widenedSum(_mm_madd_epi16(x, ones)));
+            min = _mm_min_epi16(min, x);
+            max = _mm_max_epi16(max, x);
+        }
+        alignas(16) int64_t sums[2];
+        alignas(16) int16_t mins[8];
+        alignas(16) int16_t maxs[8];
+        _mm_store_si128(reinterpret_cast<__m128i *>(sums), sum);
+        _mm_store_si128(reinterpret_cast<__m128i *>(mins), min);
+        _mm_store_si128(reinterpret_cast<__m128i *>(maxs), max);
+        summary.add(i, sums[0] + sums[1], *std::min_element(mins, mins + 8), *std::max_element(maxs, maxs + 8));
+        return i;
+    }
+
+    static size_t reduceVector(const int32_t *p, size_t n, SpanSummary_t<int32_t> &summary) {
+        if (n < 4) {
+            return 0;
+        }
+        __m128i sum = _mm_setzero_si128();
+        __m128i min = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i max = min;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+            sum = _mm_add_epi64(sum, widenedSum(x));
+            // min/max_epi32 erst ab SSE4.1: ber den Vergleich auswhlen
+            const __m128i less = _mm_cmplt_epi32(x, min);
+            min = _mm_or_si128(_mm_and_si128(less, x), _mm_andnot_si128(less, min));
+            const __m128i greater = _mm_cmpgt_epi32(x, max);
+            max = _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, max));
+        }
+        alignas(16) int64_t sums[2];
+        alignas(16) int32_t mins[4];
+        alignas(16) int32_t maxs[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(sums), sum);
+        _mm_store_si128(reinterpret_cast<__m128i *>(mins), min);
+        _mm_store_si128(reinterpret_cast<__m128i *>(maxs), max);
+        summary.add(i, sums[0] + sums[1], *std::min_element(mins, mins + 4), *std::max_element(maxs, maxs + 4));
+        return i;
+    }
+
+    /** @return Summen der int32 in x, paarweise als zwei int64 */
+    static __m128i widenedSum(__m128i x) {
+        const __m128i sign = _mm_srai_epi32(x, 31);
+        return _mm_add_epi64(_mm_unpacklo_epi32(x, sign), _mm_unpackhi_epi32(x, sign));
+    }
+#endif
+
+    static unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned int>(index);
+#else
+        return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+    }
+
+    static unsigned int highestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return static_cast<unsigned int>(index);
+#else
+        return 31u - static_cast<unsigned int>(__builtin_clz(mask));
+#endif
+    }
+};
+
+#endif
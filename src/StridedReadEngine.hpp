@@ -0,0 +1,117 @@
+#ifndef STRIDEDREADENGINE_HPP_
+#define STRIDEDREADENGINE_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "CircularBidirectionalFilereaderBuffer.hpp"
+
+/**
+ * IReadEngine, die nur jedes stride-te Element einer anderen Engine liefert: Element i ist dort das Element
+ * offset + i * stride. Ein Buffer darber liest also dezimiert, mit getNext und getPrev wie sonst, und #seek(i) springt
+ * auf offset + i * stride. Gelesen wird nur, was gebraucht wird:
+ * - Sind die Lcken kleiner als denseBytes, wird der ganze Bereich am Stck gelesen und ausgednnt (eine Seite lesen
+ *   kostet nicht mehr als ein Element daraus).
+ * - Sonst wird jedes Element fr sich gelesen. Der Aufwand hngt dann von der Anzahl Elemente ab, nicht von der
+ *   Lnge der Datei.
+ *
+ *     PreadReadEngine disk{fd};
+ *     StridedReadEngine everyThousandth{disk, 1000};
+ *     myBufferType buffer{everyThousandth};
+ *
+ * Zum Zoomen eine neue Engine (und einen neuen Buffer) mit der anderen Schrittweite. Wie die darunterliegende Engine
+ * nur aus einem Thread verwenden.
+ */
+class StridedReadEngine : public IReadEngine {
+public:
+
+    /**
+     * @param engine liefert die Elemente. Muss lnger leben als diese.
+     * @param stride Abstand der gelieferten Elemente, mindestens 1
+     * @param offset Index des ersten gelieferten Elements in engine
+     * @param denseBytes Lcken bis zu so vielen Bytes werden mitgelesen statt bersprungen
+     */
+    StridedReadEngine(IReadEngine &engine, size_t stride, size_t offset = 0, size_t denseBytes = 4096) :
+        engine_(engine), stride_(stride), offset_(offset), denseBytes_(denseBytes) {
+        assert(stride > 0);
+    }
+
+    StridedReadEngine(const StridedReadEngine &) = delete;
+    StridedReadEngine &operator=(const StridedReadEngine &) = delete;
+
+    size_t stride() const {
+        return stride_;
+    }
+
+    virtual size_t read(void *dest, size_t elementSize, size_t count, size_t first) override {
+        if (stride_ == 1) {
+            return engine_.read(dest, elementSize, count, offset_ + first);
+        }
+        char *p = static_cast<char *>(dest);
+        if (!isDense(elementSize)) {
+            for (size_t i = 0; i < count; i++) {
+                if (engine_.read(p + i * elementSize, elementSize, 1, underlying(first + i)) != 1) {
+                    return i;
+                }
+            }
+            return count;
+        }
+        // Am Stck, in Stcken von hchstens SCRATCH_BYTES
+        const size_t perChunk = std::max<size_t>(SCRATCH_BYTES / (stride_ * elementSize), 1);
+        scratch_.resize(((perChunk - 1) * stride_ + 1) * elementSize);
+        size_t done = 0;
+        while (done < count) {
+            const size_t n = std::min(perChunk, count - done);
+            const size_t nRead = engine_.read(scratch_.data(), elementSize, (n - 1) * stride_ + 1, underlying(first + done));
+            const size_t got = nRead == 0 ? 0 : std::min(n, (nRead - 1) / stride_ + 1);
+            for (size_t i = 0; i < got; i++) {
+                memcpy(p + (done + i) * elementSize, scratch_.data() + i * stride_ * elementSize, elementSize);
+            }
+            done += got;
+            if (got < n) {
+                break;
+            }
+        }
+        return done;
+    }
+
+    virtual void prefetch(size_t elementSize, size_t count, size_t first) override {
+        // Einzeln gelesene Elemente: ein Hinweis pro Element kostet etwa so viel wie das Lesen selbst
+        if (count > 0 && (stride_ == 1 || isDense(elementSize))) {
+            engine_.prefetch(elementSize, (count - 1) * stride_ + 1, underlying(first));
+        }
+    }
+
+    virtual size_t size(size_t elementSize) override {
+        const size_t n = engine_.size(elementSize);
+        if (n == std::numeric_limits<size_t>::max()) {
+            return n;
+        }
+        return n > offset_ ? (n - offset_ - 1) / stride_ + 1 : 0;
+    }
+
+private:
+
+    /** Am Stck wird mit einem Zwischenpuffer dieser Grsse gelesen */
+    static constexpr size_t SCRATCH_BYTES{ 1u << 16 };
+
+    bool isDense(size_t elementSize) const {
+        return (stride_ - 1) * elementSize < denseBytes_;
+    }
+
+    /** @return Index in engine_ des Elements i */
+    size_t underlying(size_t i) const {
+        return offset_ + i * stride_;
+    }
+
+    IReadEngine &engine_;
+    const size_t stride_;
+    const size_t offset_;
+    const size_t denseBytes_;
+    std::vector<char> scratch_;
+};
+
+#endif